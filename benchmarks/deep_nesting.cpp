@@ -0,0 +1,83 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <chrono>
+#include <iostream>
+
+/**
+ * Parses synthetic inputs that nest brackets, chain right-associative
+ * operators and stack prefix operators to the given depth, and prints the
+ * time per nesting level.
+ */
+
+static std::string nested_brackets(const size_t depth) {
+    std::string text;
+    for (size_t i = 0; i < depth; ++i) {
+        text += "{[(";
+    }
+    text += "x";
+    for (size_t i = 0; i < depth; ++i) {
+        text += ")]}";
+    }
+    return text + ";";
+}
+
+static std::string assignment_chain(const size_t depth) {
+    std::string text = "v";
+    for (size_t i = 0; i < depth; ++i) {
+        text += " = v";
+    }
+    return text + ";";
+}
+
+static std::string prefix_chain(const size_t depth) {
+    std::string text = "v = ";
+    for (size_t i = 0; i < depth; ++i) {
+        text += "- ";
+    }
+    return text + "v;";
+}
+
+static void run(const char* name, std::string text, const size_t depth) {
+    const auto begin = std::chrono::steady_clock::now();
+    reader r { text };
+    grouper g { r, size_t { 1 } << 30 };
+    const auto root = g.parse();
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << name << ": " << ns / static_cast<double>(depth)
+              << " ns/level (" << g.arena_bytes() << " bytes)\n";
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t depth = argc > 1 ? std::stoul(argv[1]) : size_t { 100000 };
+    std::cout << "depth " << depth << "\n";
+    run("brackets", nested_brackets(depth), depth);
+    run("assignments", assignment_chain(depth), depth);
+    run("prefixes", prefix_chain(depth), depth);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "expression.hpp"
+#include "grouper.hpp"
+
+#include <chrono>
+#include <iostream>
+
+/**
+ * Parses commands made of long arithmetic chains in the style of
+ * @c data/test12.qc, once through the grouper and once straight through the
+ * expression parser on pre-lexed operands, and prints the time per
+ * operator.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+static constexpr const char* chain_ops[]
+    = { "+", "*", "-", "/", "%", "<<", ">>", "&", "|", "^", "==", "<" };
+
+static std::string chain(const size_t length) {
+    std::string text = "acc += v0";
+    for (size_t i = 1; i <= length; ++i) {
+        text += " ";
+        text += chain_ops[i % std::size(chain_ops)];
+        text += i % 5 == 0 ? " -v" : " v";
+        text += std::to_string(i);
+    }
+    return text + ";\n";
+}
+
+static double nanos_per(
+    const bench_clock::duration elapsed, const size_t count
+) {
+    return std::chrono::duration<double, std::nano>(elapsed).count()
+        / static_cast<double>(count);
+}
+
+static void grouped(const std::string& line, const size_t commands) {
+    std::string text;
+    for (size_t i = 0; i < commands; ++i) {
+        text += line;
+    }
+    const auto begin = bench_clock::now();
+    reader r { text };
+    grouper g { r, size_t { 1 } << 30 };
+    const auto root = g.parse();
+    const auto elapsed = bench_clock::now() - begin;
+    std::cout << "grouper: " << nanos_per(elapsed, commands) << " ns/command\n";
+}
+
+static void direct(std::string line, const size_t length, const size_t runs) {
+    // operands and operators of the chain right of the assignment
+    line = line.substr(line.find("+=") + 2);
+    line.pop_back();
+    line.pop_back();
+    reader r { line };
+    ast_arena nodes;
+    std::vector<ast_node_ptr> chain_nodes;
+    token current;
+    while (r.skip_trivia(), r.next_token(current),
+           current.kind != token_kind::eof) {
+        chain_nodes.push_back(nodes.make<token_node>(current));
+    }
+    expression::scratch work;
+    const auto begin = bench_clock::now();
+    size_t built = 0;
+    for (size_t i = 0; i < runs; ++i) {
+        ast_arena arena;
+        size_t idx = 0;
+        expression::parse_expression(chain_nodes, idx, 0, arena, work);
+        built += arena.size();
+    }
+    const auto elapsed = bench_clock::now() - begin;
+    std::cout << "expression: " << nanos_per(elapsed, runs * length)
+              << " ns/operator (" << built << " nodes)\n";
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t length = argc > 1 ? std::stoul(argv[1]) : size_t { 64 };
+    const size_t commands = argc > 2 ? std::stoul(argv[2]) : size_t { 20000 };
+    const auto line = chain(length);
+    std::cout << commands << " chains of " << length << " operators\n";
+    grouped(line, commands);
+    direct(line, length, commands);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Parses @c data/test12.qc repeated the given number of times (262 copies
+ * are about 50k lines), then alternately types a digit into and deletes it
+ * from a body near the middle, reparsing after every keystroke. Prints the
+ * time of the full parse and the mean time per reparse, once with the whole
+ * tree resident and once squeezed to the given node limit.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+static double millis(const bench_clock::duration elapsed) {
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+static void run(std::string text, const size_t limit, const size_t edits) {
+    const size_t middle = text.find("lambda = ", text.size() / 2);
+    if (middle == std::string::npos) {
+        std::cerr << "no edit site found\n";
+        return;
+    }
+    const size_t at = middle + 9;
+    auto begin = bench_clock::now();
+    reader r { text };
+    grouper g { r, limit };
+    auto root = g.parse();
+    const double full = millis(bench_clock::now() - begin);
+
+    begin = bench_clock::now();
+    for (size_t i = 0; i < edits; ++i) {
+        const text_edit edit = i % 2 == 0 ? text_edit { at, 0, "7" }
+                                          : text_edit { at, 1, "" };
+        root = g.reparse(root, edit);
+    }
+    const double each = millis(bench_clock::now() - begin)
+        / static_cast<double>(edits);
+    std::cout << "limit " << limit << ": parse " << full << " ms, reparse "
+              << each << " ms\n";
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t copies = argc > 1 ? std::stoul(argv[1]) : size_t { 262 };
+    const size_t limit = argc > 2 ? std::stoul(argv[2]) : size_t { 2048 };
+    const char* path = argc > 3 ? argv[3] : "data/test12.qc";
+    std::ifstream file { path };
+    if (!file) {
+        std::cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+    std::stringstream unit;
+    unit << file.rdbuf();
+    std::string text;
+    for (size_t i = 0; i < copies; ++i) {
+        text += unit.str();
+    }
+    std::cout << copies << " copies, " << text.size() << " bytes\n";
+    run(text, size_t { 1 } << 30, 100);
+    run(text, limit, 100);
+    return 0;
+}
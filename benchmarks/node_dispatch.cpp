@@ -0,0 +1,143 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <chrono>
+#include <iostream>
+
+/**
+ * Classifies every node of a parsed tree the way the grouper does, once
+ * through RTTI and once through node tags, and prints the time per node.
+ */
+
+static std::string make_source(const size_t statements) {
+    std::string text;
+    for (size_t i = 0; i < statements; ++i) {
+        text += "if (a < b) { c = d + e * f; } else { g(h, i); }\n"
+                "while (x) { y = -y; return z ? y : x; }\n"
+                "f(a) { break; }\n";
+    }
+    return text;
+}
+
+static std::vector<const ast_node*> collect(const ast_node& root) {
+    std::vector<const ast_node*> nodes;
+    std::vector<const ast_node*> pending { &root };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        nodes.push_back(node);
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+    }
+    return nodes;
+}
+
+static int classify_rtti(const ast_node* node) {
+    if (dynamic_cast<const placeholder_node*>(node)) {
+        return 1;
+    }
+    if (dynamic_cast<const condition_node*>(node)) {
+        return 2;
+    }
+    if (dynamic_cast<const control_node*>(node)) {
+        return 3;
+    }
+    if (dynamic_cast<const callexp_node*>(node)) {
+        return 4;
+    }
+    if (dynamic_cast<const token_node*>(node)) {
+        return 5;
+    }
+    if (dynamic_cast<const group_node*>(node)) {
+        return 6;
+    }
+    return 0;
+}
+
+static int classify_tag(const ast_node* node) {
+    if (isa<placeholder_node>(node)) {
+        return 1;
+    }
+    if (isa<condition_node>(node)) {
+        return 2;
+    }
+    if (isa<control_node>(node)) {
+        return 3;
+    }
+    if (isa<callexp_node>(node)) {
+        return 4;
+    }
+    if (isa<token_node>(node)) {
+        return 5;
+    }
+    if (isa<group_node>(node)) {
+        return 6;
+    }
+    return 0;
+}
+
+static int classify_visit(const ast_node* node) {
+    return visit_node(*node, []<typename N>(const N&) {
+        return static_cast<int>(N::first_kind);
+    });
+}
+
+template <typename Classify>
+static void run(
+    const char* name, const std::vector<const ast_node*>& nodes,
+    const size_t rounds, Classify classify
+) {
+    long checksum = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto* node : nodes) {
+            checksum += classify(node);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << name << ": "
+              << ns / static_cast<double>(rounds * nodes.size())
+              << " ns/node (checksum " << checksum << ")\n";
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t statements
+        = argc > 1 ? std::stoul(argv[1]) : size_t { 20000 };
+    const size_t rounds = argc > 2 ? std::stoul(argv[2]) : size_t { 20 };
+    std::string text = make_source(statements);
+    reader r { text };
+    grouper g { r, size_t { 1 } << 30 };
+    const auto root = g.parse();
+    const auto nodes = collect(*root);
+    std::cout << nodes.size() << " nodes, " << rounds << " rounds\n";
+    run("rtti", nodes, rounds, classify_rtti);
+    run("tag", nodes, rounds, classify_tag);
+    run("visit", nodes, rounds, classify_visit);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * Parses @c data/test12.qc repeated the given number of times, once
+ * sequentially and then with parse_parallel() on a growing number of
+ * workers, and prints the time per pass.
+ */
+
+static double run(std::string text, const unsigned threads) {
+    const auto begin = std::chrono::steady_clock::now();
+    reader r { text };
+    grouper g { r, size_t { 1 } << 30 };
+    const auto root = threads == 0
+        ? g.parse()
+        : g.parse_parallel(group_kind::file, threads);
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t copies = argc > 1 ? std::stoul(argv[1]) : size_t { 1000 };
+    const char* path = argc > 2 ? argv[2] : "data/test12.qc";
+    std::ifstream file { path };
+    if (!file) {
+        std::cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+    std::stringstream unit;
+    unit << file.rdbuf();
+    std::string text;
+    for (size_t i = 0; i < copies; ++i) {
+        text += unit.str();
+    }
+    unsigned max_threads = 1;
+#ifdef _OPENMP
+    max_threads = static_cast<unsigned>(omp_get_max_threads());
+#endif
+    std::cout << copies << " copies, " << text.size() << " bytes\n";
+    std::cout << "sequential: " << run(text, 0) << " ms\n";
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        std::cout << "parallel x" << threads << ": " << run(text, threads)
+                  << " ms\n";
+    }
+    return 0;
+}
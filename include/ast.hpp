@@ -25,58 +25,282 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <cstddef>
+#include <limits>
 #include <memory>
 #include <queue>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "reader.hpp"
 
+/**
+ * @brief Non-owning handle to a node living in an ::ast_arena.
+ *
+ * Copying a handle is a pointer copy; the node stays valid as long as the
+ * arena that created it.
+ */
+template <typename T> class node_ptr {
+public:
+    node_ptr() noexcept = default;
+    node_ptr(std::nullptr_t) noexcept { }
+    explicit node_ptr(T* node) noexcept
+        : ptr(node) { }
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    node_ptr(const node_ptr<U>& other) noexcept
+        : ptr(other.get()) { }
+
+    [[nodiscard]] T* get() const noexcept { return ptr; }
+    T& operator*() const noexcept { return *ptr; }
+    T* operator->() const noexcept { return ptr; }
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+
+    template <typename U>
+    bool operator==(const node_ptr<U>& other) const noexcept {
+        return ptr == other.get();
+    }
+
+private:
+    T* ptr { nullptr };
+};
+
+/**
+ * @brief Dynamic type of a node, stored in ast_node::tag.
+ *
+ * Kinds are listed in pre-order of the class hierarchy, so every class
+ * covers the contiguous range [first_kind, last_kind] of itself and its
+ * descendants.
+ */
+enum class node_kind : uint8_t {
+    node,
+    token,
+    callexp,
+    fundecl,
+    control,
+    condition,
+    jump,
+    group,
+    wrapped,
+    placeholder,
+    unary,
+    binary,
+    ternary
+};
+
+/// True if @p node is a @p T or derives from it; false for null.
+template <typename T, typename U>
+[[nodiscard]] bool isa(const U* node) noexcept {
+    return node != nullptr && T::first_kind <= node->tag
+        && node->tag <= T::last_kind;
+}
+
+template <typename T, typename U>
+[[nodiscard]] bool isa(const node_ptr<U>& node) noexcept {
+    return isa<T>(node.get());
+}
+
+/// Checked downcast between node handles, null if @p node is not a @p T.
+template <typename T, typename U>
+[[nodiscard]] node_ptr<T> node_cast(const node_ptr<U>& node) noexcept {
+    if (!isa<T>(node)) {
+        return nullptr;
+    }
+    return node_ptr<T>(static_cast<T*>(node.get()));
+}
+
+struct ast_node;
+struct group_node;
+class subtree_cache;
+class spill_store;
+
+/**
+ * @brief Bump allocator owning every node of a parse.
+ *
+ * Nodes are carved out of large blocks and destroyed together with the
+ * arena, in reverse order of creation, unless release() destroyed them
+ * earlier; their memory then serves later nodes of the same size.
+ */
+class ast_arena {
+public:
+    ast_arena() = default;
+    ast_arena(const ast_arena&) = delete;
+    ast_arena& operator=(const ast_arena&) = delete;
+    ~ast_arena();
+
+    template <typename T, typename... Args> node_ptr<T> make(Args&&... args) {
+        static_assert(std::is_base_of_v<ast_node, T>);
+        void* memory = allocate(sizeof(T), alignof(T));
+        // reserve the slot first so a throwing constructor leaks nothing
+        const size_t slot = reserve_slot();
+        T* node = new (memory) T(std::forward<Args>(args)...);
+        owned[slot] = node;
+        node->slot = static_cast<uint32_t>(slot);
+        charge(*node, sizeof(T));
+        return node_ptr<T>(node);
+    }
+
+    /**
+     * @brief Destroy the nodes of the subtree of @p root owned by this arena.
+     *
+     * Used when a subtree is squeezed into a placeholder or replaced, so the
+     * arena holds no more than the resident tree. Nodes of adopted arenas are
+     * released there; those of adopted trees are left alone. No node of the
+     * subtree may be used afterwards.
+     */
+    void release(const ast_node& root);
+    /// Destroy @p node alone, its children are left as they are.
+    void release_node(const ast_node& node);
+
+    /**
+     * @brief Keep the nodes of @p other alive as long as this arena.
+     *
+     * Lets a tree link subtrees that were built in arenas of their own, e.g.
+     * on another thread.
+     */
+    void adopt(std::shared_ptr<ast_arena> other);
+    /**
+     * @brief Keep the tree of @p root alive as long as this arena.
+     *
+     * Lets new nodes be linked into a tree parsed earlier; its nodes are
+     * not counted by used() and size().
+     */
+    void adopt(std::shared_ptr<group_node> root);
+
+    /// Bytes of the live nodes, adopted arenas included.
+    [[nodiscard]] size_t used() const noexcept;
+    /// Number of live nodes, adopted arenas included.
+    [[nodiscard]] size_t size() const noexcept;
+
+private:
+    static constexpr size_t block_size = size_t { 64 } << 10;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* head { nullptr };
+    std::byte* tail { nullptr };
+    size_t used_bytes { 0 };
+    size_t live { 0 };
+    /// nodes by slot, nullptr once released
+    std::vector<ast_node*> owned;
+    std::vector<size_t> free_slots;
+    /// memory of released nodes of one size and alignment
+    struct spare_memory {
+        size_t size;
+        size_t align;
+        std::vector<void*> free;
+    };
+    std::vector<spare_memory> spare;
+    std::vector<std::shared_ptr<ast_arena>> adopted;
+    std::vector<std::shared_ptr<group_node>> trees;
+
+    void* allocate(size_t size, size_t align);
+    size_t reserve_slot();
+    /// Destroy @p node if this arena or an adopted one owns it.
+    bool destroy(const ast_node& node);
+    /// Add the node itself and the text of its tokens to its byte counters.
+    static void charge(ast_node& node, size_t own) noexcept;
+};
+
 struct ast_node {
+    static constexpr auto first_kind = node_kind::node;
+    static constexpr auto last_kind = node_kind::ternary;
+
     size_t fixed_size { 1 }, full_size { 1 };
+    /// node and token bytes of the resident subtree and of the whole subtree
+    size_t fixed_bytes { 0 }, full_bytes { 0 };
+    node_kind tag { node_kind::node };
+    /// index of the node among those of its ast_arena
+    uint32_t slot { 0 };
     virtual ~ast_node();
 
     [[nodiscard]] virtual ast_node const* get() const noexcept;
     [[nodiscard]] virtual ast_node const* first() const;
-    virtual const position& get_start() const;
+    virtual std::streamoff get_start() const;
 
     [[nodiscard]] virtual bool empty() const noexcept;
 
+    /// @param lines Index of the parsed source, to print token positions.
     virtual void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const;
-    void dump(std::ostream& os, bool full) const;
-    void dump(std::ostream& os) const;
+    void dump(std::ostream& os, const line_index& lines, bool full) const;
+    void dump(std::ostream& os, const line_index& lines) const;
 };
 
-using ast_node_ptr = std::shared_ptr<ast_node>;
+using ast_node_ptr = node_ptr<ast_node>;
 
 struct token_node : ast_node {
+    static constexpr auto first_kind = node_kind::token;
+    static constexpr auto last_kind = node_kind::jump;
+
+    token_node() noexcept;
+    explicit token_node(const token& value, uint32_t symbol = 0);
     token value;
+    /// id of a token_kind::keyword token in the reader's reader::symbols()
+    uint32_t symbol { 0 };
     [[nodiscard]] bool empty() const noexcept override;
-    const position& get_start() const override;
+    std::streamoff get_start() const override;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using token_node_ptr = std::shared_ptr<token_node>;
+using token_node_ptr = node_ptr<token_node>;
 
 enum class group_kind { file, body, list, paren, command, item, key, halt };
 
 [[nodiscard]] const char* group_kind_name(group_kind k) noexcept;
 
+/// Thrown by group_node::append() if a group cannot be squeezed into its
+/// memory budget.
+struct budget_exceeded : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Settings of the parse that squeezes a group.
+ *
+ * Handed to group_node::append() and group_node::squeeze() by the grouper;
+ * the placeholders they create are given the reader, cache, spill store and
+ * sink the parse works with.
+ */
+struct squeeze_context {
+    /// reader used to reconstruct squeezed subtrees on demand
+    reader* src { nullptr };
+    subtree_cache* cache { nullptr };
+    spill_store* spill { nullptr };
+    /// sink of a recovering parse, see placeholder_node::diagnostics
+    std::vector<diagnostic>* diagnostics { nullptr };
+    /**
+     * @brief Ceiling on ast_arena::used() in bytes, 0 for none.
+     *
+     * Groups with a memory budget squeeze their children while the arena is
+     * above it.
+     */
+    size_t arena_limit { 0 };
+};
+
 /**
  * @brief Collection of AST nodes with a configurable size limit.
  *
  * Large sub-groups may be replaced with placeholder nodes to keep
- * @c fixed_size within @c limit.
+ * @c fixed_size within @c limit, or @c fixed_bytes within @c byte_limit
+ * when a memory budget is set.
  */
 struct group_node : ast_node {
+    static constexpr auto first_kind = node_kind::group;
+    static constexpr auto last_kind = node_kind::placeholder;
+
+    group_node() noexcept;
     size_t limit; ///< Maximum allowed node weight
+    size_t byte_limit { 0 }; ///< Maximum resident bytes, 0 to count nodes
     group_kind kind { group_kind::halt };
     std::vector<ast_node_ptr> nodes;
-    /// queue of heavy child nodes: <node_size, node_index>
+    /// queue of heavy child nodes: <node_size or node_bytes, node_index>
     std::priority_queue<std::pair<size_t, size_t>> weights;
 
     /**
@@ -85,42 +309,86 @@ struct group_node : ast_node {
      * Nodes contribute their @c fixed_size and @c full_size to the parent. If
      * the accumulated @c fixed_size exceeds @c limit, larger child groups are
      * replaced with ::placeholder_node instances so the tree can be lazily
-     * expanded later.
+     * expanded later. With a @c byte_limit the same happens by bytes, and
+     * the child groups holding the most bytes go first; it also happens
+     * while @p arena holds more than squeeze_context::arena_limit. Squeezed
+     * children are released from @p arena, though @p node itself only once
+     * the append succeeded, so a caller may still report it on failure.
      *
-     * @param node Node to append.
-     * @param src  Reader used to reconstruct squeezed subtrees on demand.
+     * @param node    Node to append.
+     * @param context Settings the placeholders are created with.
+     * @param arena   Arena the placeholders are allocated in.
      */
-    void append(ast_node_ptr node, const reader& src);
+    void append(
+        ast_node_ptr node, const squeeze_context& context, ast_arena& arena
+    );
     [[nodiscard]] bool empty() const noexcept override;
     [[nodiscard]] size_t size() const noexcept;
     [[nodiscard]] ast_node const* get() const noexcept override;
     [[nodiscard]] ast_node const* first() const override;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
-    [[nodiscard]] const position& get_start() const override;
+    [[nodiscard]] std::streamoff get_start() const override;
     /**
      * @brief Replace a child group with a placeholder.
      *
      * The placeholder stores enough information to re-read the original subtree
-     * from @p src later. This is used when a group's @c fixed_size would exceed
-     * the configured limit and thus needs to be collapsed.
+     * from squeeze_context::src later. This is used when a group's
+     * @c fixed_size would exceed the configured limit and thus needs to be
+     * collapsed. The resident sizes of this group shrink accordingly.
      *
-     * @param index Index of the child to replace.
-     * @param src   Reader used to recreate the subtree if needed.
+     * @param index   Index of the child to replace.
+     * @param context Settings the placeholder is created with.
+     * @param arena   Arena the placeholder is allocated in.
      */
-    void squeeze(size_t index, const reader& src);
+    void squeeze(
+        size_t index, const squeeze_context& context, ast_arena& arena
+    );
     void pop_back();
+    /// Drop every child, keeping limits and kind.
+    void clear();
 };
 
-using group_ptr = std::shared_ptr<group_node>;
+using group_ptr = node_ptr<group_node>;
+/// Root of a parse; keeps the arena holding the whole tree alive.
+using ast_root = std::shared_ptr<group_node>;
 
 struct wrapped_node : group_node {
-    position start {};
-    const position& get_start() const override;
+    static constexpr auto first_kind = node_kind::wrapped;
+    static constexpr auto last_kind = node_kind::placeholder;
+
+    wrapped_node() noexcept;
+    std::streamoff start { 0 };
+    /// offset of the closing bracket, zero if unknown
+    std::streamoff end { 0 };
+    std::streamoff get_start() const override;
 };
 
-using wrapped_ptr = std::shared_ptr<wrapped_node>;
+using wrapped_ptr = node_ptr<wrapped_node>;
+
+/**
+ * @brief Identity of the region behind a placeholder.
+ *
+ * Nested regions may start at the same offset, so the kind, the end and
+ * the limits the region is parsed under tell them apart.
+ */
+struct subtree_key {
+    std::streamoff offset { 0 };
+    /// offset of the closing bracket, zero if unknown
+    std::streamoff end { 0 };
+    group_kind kind { group_kind::halt };
+    size_t limit { 0 };
+    size_t byte_limit { 0 };
+    size_t lazy_depth { std::numeric_limits<size_t>::max() };
+
+    bool operator==(const subtree_key&) const noexcept = default;
+};
+
+struct subtree_key_hash {
+    size_t operator()(const subtree_key& key) const noexcept;
+};
 
 /**
  * @brief Node standing in place of a squeezed sub-tree.
@@ -130,29 +398,76 @@ using wrapped_ptr = std::shared_ptr<wrapped_node>;
  * reconstructed on demand.
  */
 struct placeholder_node final : wrapped_node {
+    static constexpr auto first_kind = node_kind::placeholder;
+    static constexpr auto last_kind = node_kind::placeholder;
+
+    placeholder_node() noexcept;
     reader* src { nullptr };
+    /// cache of expanded subtrees shared with the rest of the tree, or nullptr
+    subtree_cache* cache { nullptr };
+    /// store the expanded subtree is spilled to, or nullptr
+    spill_store* spill { nullptr };
+    /// false if the grouper skipped the region, full_size then counts 1
+    bool parsed { true };
+    /// lazy depth the region is expanded with, see grouper::set_lazy_depth()
+    size_t lazy_depth { std::numeric_limits<size_t>::max() };
+    /**
+     * @brief Sink of the recovering parse that left the region, or nullptr.
+     *
+     * expand() then recovers as well and adds the errors not reported yet,
+     * such as malformed expressions, which only show once the region is
+     * identified. See grouper::set_diagnostics().
+     */
+    std::vector<diagnostic>* diagnostics { nullptr };
+    /// Key of the region in @c cache and @c spill.
+    [[nodiscard]] subtree_key key() const noexcept;
+    /**
+     * @brief Re-parse the squeezed subtree, or take it from @c cache.
+     *
+     * With a @c spill store the first expansion is written there, and later
+     * ones reload it without running the grouper. The reader position is
+     * restored after a re-parse.
+     */
+    [[nodiscard]] ast_root expand() const;
+    /**
+     * @brief Parse the region again, past @c cache and @c spill.
+     *
+     * A region that no longer fits its memory budget, as the parse that
+     * squeezed it held more of the tree, is grouped once more with every
+     * child group squeezed. The reader position is restored.
+     * @param bytes Receives the bytes of the arena of the result.
+     */
+    [[nodiscard]] ast_root regroup(size_t* bytes = nullptr) const;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using placeholder_node_ptr = std::shared_ptr<placeholder_node>;
+using placeholder_node_ptr = node_ptr<placeholder_node>;
 
 struct callexp_node : token_node {
+    static constexpr auto first_kind = node_kind::callexp;
+    static constexpr auto last_kind = node_kind::fundecl;
+
     ast_node_ptr paren;
     bool has_paren { false };
 
-    explicit callexp_node(const token& name);
+    explicit callexp_node(const token& name, uint32_t symbol = 0);
     void set_paren(ast_node_ptr paren);
 
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using callexp_ptr = std::shared_ptr<callexp_node>;
+using callexp_ptr = node_ptr<callexp_node>;
 
 struct fundecl_node : callexp_node {
+    static constexpr auto first_kind = node_kind::fundecl;
+    static constexpr auto last_kind = node_kind::fundecl;
+
     ast_node_ptr body;
     bool has_body { false };
 
@@ -160,50 +475,66 @@ struct fundecl_node : callexp_node {
     void set_body(ast_node_ptr body);
 
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using fundecl_ptr = std::shared_ptr<fundecl_node>;
+using fundecl_ptr = node_ptr<fundecl_node>;
 
 struct control_node : token_node {
+    static constexpr auto first_kind = node_kind::control;
+    static constexpr auto last_kind = node_kind::jump;
+
     ast_node_ptr body;
     bool has_body { false };
 
-    explicit control_node(const token& name);
+    explicit control_node(const token& name, uint32_t symbol = 0);
     void set_body(ast_node_ptr body);
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using control_ptr = std::shared_ptr<control_node>;
+using control_ptr = node_ptr<control_node>;
 
 struct condition_node : control_node {
+    static constexpr auto first_kind = node_kind::condition;
+    static constexpr auto last_kind = node_kind::condition;
+
     bool is_loop { false };
     ast_node_ptr paren;
     bool has_paren { false };
 
-    explicit condition_node(const token& name);
+    explicit condition_node(const token& name, uint32_t symbol = 0);
     void set_paren(ast_node_ptr paren);
 
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using condition_ptr = std::shared_ptr<condition_node>;
+using condition_ptr = node_ptr<condition_node>;
 
 struct jump_node : control_node {
-    explicit jump_node(const token& name);
+    static constexpr auto first_kind = node_kind::jump;
+    static constexpr auto last_kind = node_kind::jump;
+
+    explicit jump_node(const token& name, uint32_t symbol = 0);
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using jump_ptr = std::shared_ptr<jump_node>;
+using jump_ptr = node_ptr<jump_node>;
 
 struct unary_node : ast_node {
+    static constexpr auto first_kind = node_kind::unary;
+    static constexpr auto last_kind = node_kind::unary;
+
     token op;
     ast_node_ptr expr;
     bool is_prefix { true };
@@ -213,15 +544,19 @@ struct unary_node : ast_node {
         const token& op, ast_node_ptr expr, bool is_prefix, int priority
     );
 
-    const position& get_start() const override;
+    std::streamoff get_start() const override;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using unary_ptr = std::shared_ptr<unary_node>;
+using unary_ptr = node_ptr<unary_node>;
 
 struct binary_node : ast_node {
+    static constexpr auto first_kind = node_kind::binary;
+    static constexpr auto last_kind = node_kind::binary;
+
     token op;
     ast_node_ptr lhs;
     ast_node_ptr rhs;
@@ -231,15 +566,19 @@ struct binary_node : ast_node {
         const token& op, ast_node_ptr lhs, ast_node_ptr rhs, int priority
     );
 
-    const position& get_start() const override;
+    std::streamoff get_start() const override;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using binary_ptr = std::shared_ptr<binary_node>;
+using binary_ptr = node_ptr<binary_node>;
 
 struct ternary_node : ast_node {
+    static constexpr auto first_kind = node_kind::ternary;
+    static constexpr auto last_kind = node_kind::ternary;
+
     token qmark;
     token colon;
     ast_node_ptr cond;
@@ -252,12 +591,187 @@ struct ternary_node : ast_node {
         ast_node_ptr left, ast_node_ptr right, int priority
     );
 
-    const position& get_start() const override;
+    std::streamoff get_start() const override;
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last, bool full
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last, bool full
     ) const override;
 };
 
-using ternary_ptr = std::shared_ptr<ternary_node>;
+using ternary_ptr = node_ptr<ternary_node>;
+
+/**
+ * @brief Call @p visitor with @p node downcast to its most derived type.
+ *
+ * Dispatch is a switch over ast_node::tag; all overloads of @p visitor must
+ * return the same type.
+ */
+template <typename Visitor>
+decltype(auto) visit_node(const ast_node& node, Visitor&& visitor) {
+    switch (node.tag) {
+    case node_kind::token:
+        return visitor(static_cast<const token_node&>(node));
+    case node_kind::callexp:
+        return visitor(static_cast<const callexp_node&>(node));
+    case node_kind::fundecl:
+        return visitor(static_cast<const fundecl_node&>(node));
+    case node_kind::control:
+        return visitor(static_cast<const control_node&>(node));
+    case node_kind::condition:
+        return visitor(static_cast<const condition_node&>(node));
+    case node_kind::jump:
+        return visitor(static_cast<const jump_node&>(node));
+    case node_kind::group:
+        return visitor(static_cast<const group_node&>(node));
+    case node_kind::wrapped:
+        return visitor(static_cast<const wrapped_node&>(node));
+    case node_kind::placeholder:
+        return visitor(static_cast<const placeholder_node&>(node));
+    case node_kind::unary:
+        return visitor(static_cast<const unary_node&>(node));
+    case node_kind::binary:
+        return visitor(static_cast<const binary_node&>(node));
+    case node_kind::ternary:
+        return visitor(static_cast<const ternary_node&>(node));
+    case node_kind::node:
+        break;
+    }
+    return visitor(node);
+}
+
+/// visit_node() for a node that @p visitor may change.
+template <typename Visitor>
+decltype(auto) visit_node(ast_node& node, Visitor&& visitor) {
+    switch (node.tag) {
+    case node_kind::token:
+        return visitor(static_cast<token_node&>(node));
+    case node_kind::callexp:
+        return visitor(static_cast<callexp_node&>(node));
+    case node_kind::fundecl:
+        return visitor(static_cast<fundecl_node&>(node));
+    case node_kind::control:
+        return visitor(static_cast<control_node&>(node));
+    case node_kind::condition:
+        return visitor(static_cast<condition_node&>(node));
+    case node_kind::jump:
+        return visitor(static_cast<jump_node&>(node));
+    case node_kind::group:
+        return visitor(static_cast<group_node&>(node));
+    case node_kind::wrapped:
+        return visitor(static_cast<wrapped_node&>(node));
+    case node_kind::placeholder:
+        return visitor(static_cast<placeholder_node&>(node));
+    case node_kind::unary:
+        return visitor(static_cast<unary_node&>(node));
+    case node_kind::binary:
+        return visitor(static_cast<binary_node&>(node));
+    case node_kind::ternary:
+        return visitor(static_cast<ternary_node&>(node));
+    case node_kind::node:
+        break;
+    }
+    return visitor(node);
+}
+
+/**
+ * @brief Offset of the leftmost token of @p node.
+ *
+ * Unlike ast_node::get_start(), which names the operator of an expression,
+ * this is where the node begins in the source. Placeholders of brackets
+ * report their first inner token. nullptr if @p node holds no token.
+ */
+const std::streamoff* first_offset(const ast_node& node) noexcept;
+
+/**
+ * @brief Whether group_node::squeeze() may collapse @p group.
+ *
+ * The region must start at a known token; one that begins with a
+ * placeholder of brackets does not, as that reports its first inner token.
+ * Commands that an else, elif, catch or finally joined span more than the
+ * one command a region is parsed as.
+ */
+bool squeezable(const group_node& group) noexcept;
+
+/// Call @p callback on every direct child of @p node, in dump order.
+template <typename Callback>
+void for_each_child(const ast_node& node, Callback&& callback) {
+    visit_node(node, [&callback]<typename N>(const N& n) {
+        if constexpr (std::is_base_of_v<group_node, N>) {
+            for (const auto& child : n.nodes) {
+                callback(*child);
+            }
+        } else if constexpr (std::is_base_of_v<callexp_node, N>) {
+            if (n.has_paren) {
+                callback(*n.paren);
+            }
+            if constexpr (std::is_same_v<fundecl_node, N>) {
+                if (n.has_body) {
+                    callback(*n.body);
+                }
+            }
+        } else if constexpr (std::is_base_of_v<control_node, N>) {
+            if constexpr (std::is_same_v<condition_node, N>) {
+                if (n.has_paren) {
+                    callback(*n.paren);
+                }
+            }
+            if (n.has_body) {
+                callback(*n.body);
+            }
+        } else if constexpr (std::is_same_v<unary_node, N>) {
+            callback(*n.expr);
+        } else if constexpr (std::is_same_v<binary_node, N>) {
+            callback(*n.lhs);
+            callback(*n.rhs);
+        } else if constexpr (std::is_same_v<ternary_node, N>) {
+            callback(*n.cond);
+            callback(*n.left);
+            callback(*n.right);
+        }
+    });
+}
+
+/**
+ * @brief Call @p callback on the handle of every direct child of @p node.
+ *
+ * Unlike for_each_child(), the callback may put another node in its place.
+ */
+template <typename Callback>
+void for_each_child_slot(ast_node& node, Callback&& callback) {
+    visit_node(node, [&callback]<typename N>(N& n) {
+        if constexpr (std::is_base_of_v<group_node, N>) {
+            for (auto& child : n.nodes) {
+                callback(child);
+            }
+        } else if constexpr (std::is_base_of_v<callexp_node, N>) {
+            if (n.has_paren) {
+                callback(n.paren);
+            }
+            if constexpr (std::is_same_v<fundecl_node, N>) {
+                if (n.has_body) {
+                    callback(n.body);
+                }
+            }
+        } else if constexpr (std::is_base_of_v<control_node, N>) {
+            if constexpr (std::is_same_v<condition_node, N>) {
+                if (n.has_paren) {
+                    callback(n.paren);
+                }
+            }
+            if (n.has_body) {
+                callback(n.body);
+            }
+        } else if constexpr (std::is_same_v<unary_node, N>) {
+            callback(n.expr);
+        } else if constexpr (std::is_same_v<binary_node, N>) {
+            callback(n.lhs);
+            callback(n.rhs);
+        } else if constexpr (std::is_same_v<ternary_node, N>) {
+            callback(n.cond);
+            callback(n.left);
+            callback(n.right);
+        }
+    });
+}
 
 #endif // AST_HPP
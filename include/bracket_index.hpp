@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef BRACKET_INDEX_HPP
+#define BRACKET_INDEX_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/// Offsets of an opening bracket and of the bracket closing it.
+struct bracket_pair {
+    size_t open;
+    size_t close;
+};
+
+/**
+ * @brief Matched brackets of a source text, found without lexing it.
+ *
+ * Candidate bytes come from scanner::structural(); only those are looked at
+ * to match brackets and to skip string literals and comments the way the
+ * reader does. Matching stops at the first bracket that is closed by the
+ * wrong kind, has no partner, or is still open at the end of the text.
+ */
+class bracket_index {
+public:
+    bracket_index() = default;
+    explicit bracket_index(std::string_view text);
+
+    /// Pairs matched before the first unbalanced bracket, by open offset.
+    [[nodiscard]] const std::vector<bracket_pair>& pairs() const noexcept;
+    /// Offset of the bracket closing the one at @p open, if it was matched.
+    [[nodiscard]] std::optional<size_t> close_of(size_t open) const;
+    /// True if every bracket outside of strings and comments is matched.
+    [[nodiscard]] bool balanced() const noexcept;
+    /**
+     * @brief Offset of the first unbalanced bracket.
+     *
+     * That is a closing bracket of the wrong kind or without an open one,
+     * or the innermost bracket left open at the end of the text.
+     */
+    [[nodiscard]] std::optional<size_t> unbalanced() const noexcept;
+
+private:
+    std::vector<bracket_pair> matched;
+    std::optional<size_t> first_unbalanced;
+};
+
+#endif // BRACKET_INDEX_HPP
@@ -0,0 +1,70 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef EVENT_HANDLER_HPP
+#define EVENT_HANDLER_HPP
+
+#include "ast.hpp"
+#include "reader.hpp"
+
+/**
+ * @brief Receiver of the events of grouper::parse(event_handler&).
+ *
+ * Events arrive in source order during a single forward pass; no tree is
+ * built. Every callback does nothing by default, so consumers override only
+ * what they need. Tokens passed in view the reader's source and are only
+ * valid during the callback, as a stream-backed reader reuses its chunk;
+ * see reader::set_retain_chunks().
+ */
+class event_handler {
+public:
+    virtual ~event_handler() = default;
+
+    /// A bracket opened, or the parse began with the top-level @p kind.
+    virtual void enter_group(group_kind kind, const position& start) {
+        (void)kind;
+        (void)start;
+    }
+    /// The bracket of @p kind closed, or the top-level group ended.
+    virtual void leave_group(group_kind kind, const position& end) {
+        (void)kind;
+        (void)end;
+    }
+    /// A separator ended a group_kind::command, item or key.
+    virtual void separator(group_kind kind, const token& tok) {
+        (void)kind;
+        (void)tok;
+    }
+    /// Name directly followed by an opening parenthesis.
+    virtual void call(const token& name) { (void)name; }
+    /// Reserved word such as @c if, @c else or @c return.
+    virtual void control(const token& keyword) { (void)keyword; }
+    /// Operator, see token::op; arity is not resolved.
+    virtual void op(const token& tok) { (void)tok; }
+    /// Any other token: names, literals and special characters.
+    virtual void value(const token& tok) { (void)tok; }
+};
+
+#endif // EVENT_HANDLER_HPP
@@ -26,59 +26,69 @@
 #define EXPRESSION_HPP
 
 #include "ast.hpp"
-#include <string_view>
-#include <unordered_map>
+#include <span>
 #include <vector>
 
 class expression {
 public:
+    /// Operator waiting for its right operand, or a ternary for its branches.
+    struct pending {
+        enum class step { binary, middle, right } stage;
+        int min_prec;
+        ast_node_ptr left;
+        const token* op;
+        int prec;
+        ast_node_ptr middle;
+        const token* colon;
+    };
+
     /**
-     * @brief Element of the input stream for the expression parser.
-     * @details When @c is_op is set the item represents an operator token;
-     *          otherwise it stores a pointer to an AST node.
+     * @brief Storage of the parser, reused from one expression to the next.
+     *
+     * Once its vectors have grown to the deepest expression seen, parsing
+     * allocates only the resulting nodes. Each call starts over, so one
+     * scratch serves one parse at a time. Callers assembling their input
+     * from several groups may borrow @c input and @c colon for it.
      */
-    struct item {
-        bool is_op { false };
-        token tok;
-        ast_node_ptr node;
+    struct scratch {
+        std::vector<pending> stack;
+        std::vector<const token*> prefixes;
+        std::vector<ast_node_ptr> input;
+        token_node colon;
     };
 
     /**
-     * @brief Split a raw node list into tokens and operands.
+     * @brief Operator token of @p node, nullptr if it is an operand.
      *
-     * Consecutive operator tokens are combined into multi-character operators
-     * such as <tt>+=</tt> or <tt>==</tt>.
+     * Special characters and separators are operators; multi-character
+     * operators such as <tt>+=</tt> or <tt>==</tt> already arrive as single
+     * tokens from the reader.
      */
-    static std::vector<item> make_items(const std::vector<ast_node_ptr>& nodes);
+    static const token* operator_of(const ast_node_ptr& node) noexcept;
     /**
-     * @brief Parse a binary/ternary expression from a token list.
+     * @brief Parse a binary/ternary expression from a node list.
      *
      * The function implements a Pratt style parser. @p min_prec
      * specifies the minimal operator precedence accepted for the
      * current recursion level.
      *
-     * @param items  Token/operand stream produced by make_items().
-     * @param idx    Current position within @p items, updated on return.
+     * @param nodes  Operands and operator tokens, e.g. a group's children.
+     * @param idx    Current position within @p nodes, updated on return.
      * @param min_prec Minimal precedence level to parse.
+     * @param arena  Arena the operator nodes are allocated in.
+     * @param work   Storage reused between calls.
      */
-    static ast_node_ptr
-    parse_expression(std::vector<item>& items, size_t& idx, int min_prec);
+    static ast_node_ptr parse_expression(
+        std::span<const ast_node_ptr> nodes, size_t& idx, int min_prec,
+        ast_arena& arena, scratch& work
+    );
     /**
      * @brief Parse a prefix expression and any trailing postfix operators.
      */
-    static ast_node_ptr parse_prefix(std::vector<item>& items, size_t& idx);
-
-private:
-    static token make_token(const token_node& tn, std::string_view word);
-
-    static bool match_op(
-        const std::vector<ast_node_ptr>& nodes, size_t pos, std::string_view op
+    static ast_node_ptr parse_prefix(
+        std::span<const ast_node_ptr> nodes, size_t& idx, ast_arena& arena,
+        scratch& work
     );
-
-    static const std::unordered_map<std::string, std::pair<int, bool>>
-        binary_ops;
-    static const std::unordered_map<std::string, int> prefix_ops;
-    static const std::unordered_map<std::string, int> postfix_ops;
 };
 
 #endif // EXPRESSION_HPP
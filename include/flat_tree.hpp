@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef FLAT_TREE_HPP
+#define FLAT_TREE_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "ast.hpp"
+
+/**
+ * @brief Index-based, struct-of-arrays copy of an AST.
+ *
+ * Nodes are numbered in pre-order (the root is node 0) and linked through
+ * 32-bit first-child / next-sibling indices, so a traversal walks a few
+ * contiguous arrays instead of chasing pointers. Children keep the order in
+ * which ast_node::dump() prints them. Tokens are copied into a side table
+ * and still view the parsed source, unless the tree was deserialized, in
+ * which case they view one text pool the tree shares with its copies and
+ * inflated trees. A flat tree is immutable and can be shared between
+ * threads.
+ */
+class flat_tree {
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    flat_tree() = default;
+    /// Flatten the tree below @p root; placeholders stay collapsed.
+    explicit flat_tree(const ast_node& root);
+
+    [[nodiscard]] size_t size() const noexcept;
+    [[nodiscard]] node_kind kind(uint32_t node) const noexcept;
+    /// group kind of group, wrapped and placeholder nodes
+    [[nodiscard]] group_kind group(uint32_t node) const noexcept;
+    [[nodiscard]] uint32_t first_child(uint32_t node) const noexcept;
+    [[nodiscard]] uint32_t next_sibling(uint32_t node) const noexcept;
+    /**
+     * @brief Token of @p node, or nullptr.
+     *
+     * Named nodes return their name, operators their operator token; the
+     * colon of a ternary follows its question mark in the table.
+     */
+    [[nodiscard]] const token* value(uint32_t node) const noexcept;
+    /// Id of the keyword token of @p node, see token_node::symbol.
+    [[nodiscard]] uint32_t symbol(uint32_t node) const noexcept;
+    [[nodiscard]] size_t fixed_size(uint32_t node) const noexcept;
+    [[nodiscard]] size_t full_size(uint32_t node) const noexcept;
+    /// Start offset of a wrapped or placeholder node, or nullptr.
+    [[nodiscard]] const std::streamoff* start(uint32_t node) const noexcept;
+
+    /// Same output as ast_node::dump(), without recursion.
+    void dump(std::ostream& os, const line_index& lines, bool full) const;
+
+    void serialize(std::ostream& os) const;
+    /**
+     * @brief Read a tree written by serialize().
+     *
+     * Keyword tokens are id'd in @p symbols, the table of the reader the
+     * tree is inflated for.
+     * @throw std::runtime_error on malformed input.
+     */
+    static flat_tree deserialize(std::istream& is, interner& symbols);
+
+    /**
+     * @brief Rebuild the pointer tree of a flattened placeholder expansion.
+     *
+     * Groups take their limits from @p origin, and placeholders also its
+     * reader, cache and spill store, so they expand as if freshly parsed.
+     * @throw std::runtime_error if the root is not a group.
+     */
+    [[nodiscard]] ast_root inflate(const placeholder_node& origin) const;
+
+private:
+    enum flag : uint8_t {
+        has_paren = 1,
+        has_body = 2,
+        is_prefix = 4,
+        is_loop = 8,
+        is_skipped = 16 ///< placeholder the grouper did not parse
+    };
+
+    std::vector<node_kind> kinds;
+    std::vector<group_kind> groups;
+    std::vector<uint8_t> flags;
+    std::vector<uint8_t> priorities;
+    std::vector<uint32_t> first_children;
+    std::vector<uint32_t> next_siblings;
+    std::vector<uint32_t> token_index;
+    std::vector<uint32_t> fixed_sizes;
+    std::vector<uint32_t> full_sizes;
+    std::vector<token> tokens;
+    /// keyword ids of @c tokens, 0 for the other kinds
+    std::vector<uint32_t> symbols;
+    /// text the tokens of a deserialized tree view
+    std::shared_ptr<const std::string> pool;
+    /// what wrapped and placeholder nodes hold beyond a group
+    struct region {
+        uint32_t node;
+        std::streamoff start;
+        std::streamoff end;
+        /// bytes of the whole subtree, which a placeholder only stands for
+        uint64_t full_bytes;
+    };
+    /// regions of wrapped and placeholder nodes, by node
+    std::vector<region> regions;
+
+    uint32_t add(const ast_node& node);
+    [[nodiscard]] const region* find_region(uint32_t node) const noexcept;
+};
+
+#endif // FLAT_TREE_HPP
@@ -26,6 +26,21 @@
 #define GROUPER_HPP
 
 #include "ast.hpp"
+#include "event_handler.hpp"
+#include "expression.hpp"
+#include "flat_tree.hpp"
+#include "lexer.hpp"
+#include "spill_store.hpp"
+#include "subtree_cache.hpp"
+
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+/// Upper bound on the resident bytes of a parsed tree.
+struct memory_budget {
+    size_t bytes;
+};
 
 /**
  * @brief Parses tokens into hierarchical groups and expressions.
@@ -35,22 +50,258 @@
  */
 class grouper {
 public:
-    explicit grouper(reader& r, size_t limit = 64);
+    /**
+     * @param cache Optional cache that the placeholders of the result use to
+     *              keep expanded subtrees resident.
+     * @param spill Optional store that expanded subtrees are spilled to.
+     */
+    explicit grouper(
+        reader& r, size_t limit = 64, subtree_cache* cache = nullptr,
+        spill_store* spill = nullptr
+    );
+    /**
+     * @brief Squeeze by bytes instead of nodes.
+     *
+     * Every group keeps the node and token bytes of its resident subtree
+     * within @p budget, so the root bounds the memory of the whole tree.
+     */
+    grouper(
+        reader& r, memory_budget budget, subtree_cache* cache = nullptr,
+        spill_store* spill = nullptr
+    );
     /**
      * @brief Parse a sequence starting at the current reader position.
+     *
+     * All nodes of the result live in one arena that is released together
+     * with the returned root. Files of a resident source are checked for
+     * unbalanced brackets before they are grouped.
      * @param kind Expected top-level group kind.
      */
-    group_ptr parse(group_kind kind = group_kind::file);
+    ast_root parse(group_kind kind = group_kind::file);
+    /**
+     * @brief Report the structure to @p handler in one forward pass.
+     *
+     * Tokens are read one at a time through the reader and no node is
+     * built, so memory stays proportional to the bracket nesting depth.
+     * Grouping stops at brackets and separators: calls, reserved words and
+     * operators are reported as seen, without identification or expression
+     * parsing.
+     * @param kind Top-level kind: file ends at eof, body, list and paren at
+     *             the matching closing bracket.
+     * @throw std::runtime_error on mismatched brackets or lexical errors.
+     */
+    void parse(event_handler& handler, group_kind kind = group_kind::file);
+    /**
+     * @brief Parse like parse() and return the result as a flat_tree.
+     *
+     * The pointer tree is released before returning.
+     */
+    flat_tree parse_flat(group_kind kind = group_kind::file);
+    /**
+     * @brief Parse like parse(), building top-level bodies concurrently.
+     *
+     * The reader's bracket_index yields the <tt>{ ... }</tt> spans at the
+     * outermost level. Each one is grouped and identified on a worker
+     * with an arena of its own, then the outer level is parsed sequentially
+     * and links the finished bodies in. The result equals that of parse();
+     * bodies that fail on a worker are parsed again in place, so errors are
+     * reported the same way. Stream-backed readers parse sequentially.
+     * @param threads Worker count, 0 picks the OpenMP default.
+     */
+    ast_root parse_parallel(
+        group_kind kind = group_kind::file, unsigned threads = 0
+    );
+    /**
+     * @brief Apply @p edit to the reader and bring @p previous up to date.
+     *
+     * @p previous must be the parse() of the whole resident source with
+     * group_kind::file. Only the innermost region enclosing the edit is
+     * parsed again: the inside of a bracket, or a squeezed command, item or
+     * key. The rest of the tree is kept, with positions past the edit moved
+     * and token text pointed into the edited source, so the cost follows the
+     * resident nodes and the size of that region rather than the file.
+     * Regions that no longer parse on their own are widened to the enclosing
+     * one, and the whole source is parsed again as a last resort.
+     *
+     * @p previous is updated in place and must not be used on its own
+     * afterwards; it stays alive with the result, and so do the nodes the
+     * update replaced. Cached and spilled subtrees are dropped.
+     * @throw std::runtime_error if the edited source does not parse.
+     */
+    ast_root reparse(const ast_root& previous, const text_edit& edit);
+    /**
+     * @brief Leave brackets nested @p depth or more levels deep unparsed.
+     *
+     * Such brackets are skipped to their partner through the reader's
+     * bracket_index and become placeholders that are only parsed once they
+     * are expanded. Depth 0 skips every bracket at the outermost level.
+     * Readers that are stream-backed still parse everything.
+     */
+    void set_lazy_depth(size_t depth) noexcept;
+    /**
+     * @brief Recover from errors in the source instead of throwing.
+     *
+     * Every problem is appended to @p sink and parsing goes on, so one
+     * parse() reports them all. Lexical errors become token_kind::error
+     * tokens that run to the next <tt>;</tt>, <tt>}</tt> or line break.
+     * Brackets left open are closed where an enclosing bracket or the input
+     * ends, and stray closing brackets become error tokens. Misplaced
+     * keywords and malformed expressions are kept as they are. A limit or
+     * memory budget that is too small still throws. nullptr restores
+     * throwing on the first error.
+     *
+     * Regions squeezed or skipped before they were identified report the
+     * rest of their errors once their placeholders are expanded, so @p sink
+     * must outlive the tree.
+     */
+    void set_diagnostics(std::vector<diagnostic>* sink) noexcept;
+    /**
+     * @brief Under a memory budget, squeeze every child group right away.
+     *
+     * The tree then holds as few bytes as it can, and groups that still
+     * exceed the budget are kept rather than rejected.
+     * placeholder_node::regroup() falls back to this for regions that do not
+     * fit their budget otherwise, which happens when identification makes a
+     * region squeezed unidentified larger.
+     */
+    void set_eager_squeeze(bool eager) noexcept;
+    /**
+     * @brief Node storage in bytes taken by the tree of the last parse(),
+     * or by the region rebuilt in the last reparse().
+     */
+    [[nodiscard]] size_t arena_bytes() const noexcept;
 
 private:
     reader& src;
     size_t limit;
+    size_t byte_limit { 0 };
+    size_t lazy_depth { std::numeric_limits<size_t>::max() };
+    /// brackets around the parsed text, counted against @c lazy_depth
+    size_t nesting { 0 };
+    bool eager { false };
     token current;
-    position pos {};
+    /// id of @c current if it is a keyword, see token_node::symbol
+    uint32_t symbol { 0 };
     bool reuse { false };
+    subtree_cache* cache;
+    spill_store* spill;
+    /// arena of the parse in progress
+    ast_arena* arena { nullptr };
+    /// settings its groups squeeze with, see group_node::append()
+    squeeze_context squeezing;
+    size_t parsed_bytes { 0 };
+    /// token stream of a resident source, nullptr to lex through @c src
+    const token_stream* stream { nullptr };
+    size_t cursor { 0 };
+    /// worker of parse_parallel(), must not move or query @c src
+    bool detached { false };
+    /// sink of a recovering parse, nullptr to throw
+    std::vector<diagnostic>* diagnostics { nullptr };
+    /// storage reused by every expression parse_arithmetic() builds
+    mutable expression::scratch expressions;
+
+    /// top-level body built ahead of the parse by a worker
+    struct prepared_body {
+        size_t open;
+        size_t close;
+        std::shared_ptr<ast_arena> arena;
+        group_ptr raw;
+        group_ptr result;
+    };
+    std::vector<prepared_body> prepared;
+    size_t next_prepared { 0 };
+    /**
+     * @brief Prepared bodies linked into the parse, by their raw group.
+     *
+     * identify() substitutes the identified form and adopts the arena of
+     * those that were not squeezed away in the meantime.
+     */
+    std::unordered_map<const ast_node*, const prepared_body*> identified;
+
+    /// region of the source a reparse() may parse again on its own
+    struct damaged_region {
+        /// the node standing for the region, and its depth in the path
+        ast_node* node;
+        size_t depth;
+        group_kind kind;
+        /// first byte
+        std::streamoff begin;
+        /// one past the last byte, before the edit
+        std::streamoff end;
+        /// lazy depth and brackets around the region, see grouper::nesting
+        size_t lazy_depth;
+        size_t nesting;
+    };
+    /**
+     * @brief Regions of @p root enclosing [@p from, @p to), outermost first.
+     *
+     * @p path receives the resident nodes from the root down to the
+     * innermost region.
+     */
+    [[nodiscard]] std::vector<damaged_region> find_damaged(
+        group_node& root, std::streamoff from, std::streamoff to,
+        std::vector<ast_node*>& path
+    ) const;
+    /**
+     * @brief Parse @p region of the edited source on a worker grouper.
+     * @param shift Bytes inserted minus bytes removed by the edit.
+     * @return the region's tree, empty if it does not parse on its own.
+     */
+    [[nodiscard]] ast_root
+    parse_damaged(const damaged_region& region, std::streamoff shift);
+    /// node and byte counters of a node, see ast_node
+    struct node_sizes {
+        size_t fixed_size, full_size, fixed_bytes, full_bytes;
+    };
+    /**
+     * @brief Add the size change of @p path[depth] to its ancestors.
+     *
+     * Groups pushed over their limit squeeze their heaviest children, just
+     * as group_node::append() would.
+     * @param before Counters of @p path[depth] before it changed.
+     * @param owner  Arena the placeholders are allocated in.
+     * @return false if a group cannot be brought within its limit.
+     */
+    bool resize_path(
+        const std::vector<ast_node*>& path, size_t depth,
+        const node_sizes& before, ast_arena& owner
+    ) const;
 
     void peek();
+    /// Move @c src just past the last token taken from @c stream.
+    void sync() const;
+    /**
+     * @brief Switch to the token stream of a resident source, if it lexes.
+     * @param lex Lex the source unless that happened before; otherwise only
+     *            a stream built earlier is used.
+     */
+    void open_stream(bool lex);
+    /**
+     * @brief Fail fast on the first unbalanced bracket past the cursor.
+     *
+     * Looks it up in the reader's bracket_index, so a file whose brackets
+     * do not match is rejected before any of it is grouped.
+     */
+    void check_balance();
+    /// Group and identify @p body on a worker grouper.
+    void prepare(prepared_body& body);
+    /**
+     * @brief Take the prepared body opened by the current token.
+     *
+     * On success the cursor is moved past its closing bracket and the raw
+     * group is returned; otherwise the result is empty.
+     */
+    group_ptr take_prepared();
+    /**
+     * @brief Skip the bracket of the current token unparsed.
+     *
+     * On success the cursor is moved past its partner and a placeholder for
+     * the region is returned; empty brackets and brackets missing from the
+     * index yield an empty result.
+     */
+    group_ptr skip_wrapped();
 
+    /// Create the group receiving the identified children of @p group.
     [[nodiscard]] group_ptr identify_subgroup(const group_ptr& group) const;
     /**
      * @brief Attach @p inode to the last statement if it is a secondary
@@ -61,6 +312,13 @@ private:
      */
     [[nodiscard]] bool
     handle_chain(const group_ptr& result, const group_ptr& inode) const;
+    /**
+     * @brief Parse the region of @p ph again, for a keyword to join it.
+     *
+     * The tree is adopted by the arena of the parse in progress. Workers of
+     * parse_parallel() cannot do this, as they must not move the reader.
+     */
+    [[nodiscard]] group_ptr restore(const placeholder_node& ph) const;
 
     bool append_group(
         const group_ptr& result, const ast_node_ptr& node,
@@ -69,7 +327,22 @@ private:
 
     void identify_body(const group_ptr& group) const;
 
+    /**
+     * @brief Identify control flow in @p group and its subgroups.
+     *
+     * Nested groups are walked with an explicit stack; each finished
+     * subgroup runs through parse_arithmetic() before its parent goes on.
+     */
     void identify(const group_ptr& group, const group_ptr& result) const;
+    /**
+     * @brief Place one identified child into @p result.
+     * @param group Original kind if @p node is a group, empty otherwise.
+     */
+    void identify_node(
+        const group_ptr& result, const ast_node_ptr& node,
+        std::optional<group_kind> group, bool& wait_for_condition,
+        bool& wait_for_body
+    ) const;
     /**
      * @brief Transform token groups representing arithmetic into AST nodes.
      *
@@ -78,6 +351,8 @@ private:
      * expression subtree.
      */
     void parse_arithmetic(const group_ptr& group) const;
+    /// Release the operator tokens of @p nodes once an expression copied them.
+    void release_operators(const std::vector<ast_node_ptr>& nodes) const;
     /**
      * @brief Close the current command when a separator is encountered.
      */
@@ -86,19 +361,22 @@ private:
     /**
      * @brief Begin parsing of a bracketed sub-group.
      *
-     * Pushes a new wrapped_node onto @p top when an opening bracket is
-     * encountered.
+     * Creates the wrapped_node for the opening bracket; parse_group() fills
+     * it and appends it to @p top once the bracket is closed.
      */
-    void append_wrapped(const group_ptr& top);
+    group_ptr append_wrapped(const group_ptr& top) const;
     /**
      * @brief Finalize a wrapped sub-group when a closing bracket is seen.
      */
-    void close_wrapped(const group_ptr& group, group_ptr& top, group_kind kind);
+    void close_wrapped(
+        const group_ptr& group, const group_ptr& top, group_kind kind
+    );
     /**
      * @brief Parse a sequence of tokens into the supplied group.
      *
      * This is the core loop that recognises brackets and separators and
-     * builds the initial hierarchical structure.
+     * builds the initial hierarchical structure. Nested brackets are kept on
+     * an explicit stack, so the nesting depth is not bound by the native one.
      */
     void parse_group(group_kind kind, group_ptr& group);
     /**
@@ -108,6 +386,14 @@ private:
         const group_ptr& parent, const ast_node_ptr& node,
         const std::source_location& location = std::source_location::current()
     ) const;
+    /**
+     * @brief Record @p message at @p at when recovering, throw it otherwise.
+     */
+    void fail(
+        const std::string& message, std::streamoff at,
+        const group_ptr& context = {},
+        const std::source_location& location = std::source_location::current()
+    ) const;
     /**
      * @brief Create a formatted runtime error describing a parse failure.
      */
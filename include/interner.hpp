@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Symbol ids pre-assigned to the reserved words.
+ *
+ * The token stream and the AST tag every keyword token with its symbol, so
+ * keyword dispatch is a switch over these values.
+ */
+enum class reserved : uint32_t {
+    none, ///< id 0 is never assigned to a name
+    kw_if,
+    kw_elif,
+    kw_else,
+    kw_while,
+    kw_for,
+    kw_catch,
+    kw_try,
+    kw_finally,
+    kw_return,
+    kw_continue,
+    kw_break,
+    kw_goto
+};
+
+/// Reserved word spelled @p word, reserved::none for any other name.
+[[nodiscard]] reserved reserved_word(std::string_view word) noexcept;
+/// Spelling of @p kw, empty for reserved::none.
+[[nodiscard]] std::string_view reserved_name(reserved kw) noexcept;
+
+/**
+ * @brief Thread-safe table mapping identifiers to dense 32-bit ids.
+ *
+ * Each distinct name is stored once; ids are never reused or invalidated,
+ * so identifier equality is id equality within a table. Every reader owns a
+ * table, which lives as long as the parses over it; readers of a multi-file
+ * build can share one through reader::set_symbols(). The reserved words have
+ * the same ids in every table and are resolved without locking.
+ */
+class interner {
+public:
+    interner();
+    interner(const interner&) = delete;
+    interner& operator=(const interner&) = delete;
+
+    /// Id of @p name, assigning the next free one on first sight.
+    uint32_t intern(std::string_view name);
+    /// Name of @p id; empty for reserved::none and unknown ids.
+    [[nodiscard]] std::string_view name(uint32_t id) const;
+    [[nodiscard]] size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    /// names by id, element addresses are stable under push_back
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+#endif // INTERNER_HPP
@@ -0,0 +1,146 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LEXER_HPP
+#define LEXER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "reader.hpp"
+
+/**
+ * @brief Lexed tokens stored as parallel arrays.
+ *
+ * Each token takes its kind, operator, offset, length and symbol, 14 bytes in
+ * all. The offset is that of the first byte, the quote of a string literal;
+ * the length runs to the byte past the token. String literals that contain
+ * escapes keep their decoded value, and numeric literals their parsed value,
+ * in side tables keyed by token index, so neither is parsed again.
+ */
+struct token_columns {
+    std::vector<uint8_t> kinds;
+    std::vector<op_kind> ops;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> symbols;
+    /// decoded string literals with escapes: <token_index, value>
+    std::vector<std::pair<uint32_t, std::string>> literals;
+    /// parsed numeric literals: <token_index, value>
+    std::vector<std::pair<uint32_t, numeric_value>> numbers;
+
+    [[nodiscard]] size_t size() const noexcept;
+    /// offset just past entry @p index
+    [[nodiscard]] std::streamoff end(size_t index) const noexcept;
+    /**
+     * @brief Append @p t, whose offset is that in the lexed source.
+     * @param table Table that ids @p t if it is a keyword.
+     */
+    void push_back(const token& t, interner& table);
+    /// append the entries of @p other from index @p first on
+    void append(const token_columns& other, size_t first);
+};
+
+/**
+ * @brief Compact, index-addressable token sequence of a whole source.
+ *
+ * Tokens are kept as ::token_columns, so iterating them touches 14 bytes per
+ * token instead of a full ::token. Text is viewed in the source on demand.
+ * Trivia is not stored, the last entry is always token_kind::eof.
+ */
+class token_stream {
+public:
+    /**
+     * @brief Lex the resident source of @p src through lexer::tokenize().
+     * @throw std::runtime_error on a lexical error, if @p src is
+     *        stream-backed or larger than 4 GiB.
+     */
+    explicit token_stream(const reader& src, unsigned threads = 0);
+
+    [[nodiscard]] size_t size() const noexcept;
+    [[nodiscard]] token_kind kind(size_t index) const noexcept;
+    [[nodiscard]] op_kind op(size_t index) const noexcept;
+    [[nodiscard]] uint32_t symbol(size_t index) const noexcept;
+    [[nodiscard]] std::streamoff offset(size_t index) const noexcept;
+    /// offset just past the token, including the quotes of strings
+    [[nodiscard]] std::streamoff end(size_t index) const noexcept;
+    /// same view as token::word
+    [[nodiscard]] std::string_view word(size_t index) const noexcept;
+    /// decoded value of a string literal, token::text() for the others
+    [[nodiscard]] std::string_view literal(size_t index) const noexcept;
+    /// parsed value of a numeric literal, zero for the other kinds
+    [[nodiscard]] numeric_value number(size_t index) const noexcept;
+    /// index of the first token starting at or after @p offset
+    [[nodiscard]] size_t find(std::streamoff offset) const noexcept;
+    /// Materialize entry @p index into @p out.
+    void read(size_t index, token& out) const;
+
+private:
+    std::string_view text;
+    token_columns columns;
+};
+
+/**
+ * @brief Whole-input tokenization passes over a resident reader source.
+ */
+class lexer {
+public:
+    /**
+     * @brief Tokenize the resident source of @p src on several threads.
+     *
+     * The source is cut into chunks that are lexed concurrently and
+     * speculatively, as if no string or comment were open at their first
+     * byte. The chunks are then stitched in order: once the true token
+     * sequence reaches a token start that a chunk also produced, the rest of
+     * that chunk is taken as is; wherever a guess was wrong (or failed) the
+     * stitcher lexes sequentially until the two agree again.
+     *
+     * The result is identical to calling reader::next_token() until eof
+     * (with skip_trivia() before each call unless @p keep_trivia is set),
+     * including the final eof token. @p src itself is not advanced.
+     *
+     * @param threads    Worker count, 0 picks the OpenMP default.
+     * @param chunk_size Target number of bytes per chunk.
+     * @throw std::runtime_error on the first lexical error, if @p src is
+     *        stream-backed or larger than 4 GiB.
+     */
+    static std::vector<token> tokenize(
+        const reader& src, bool keep_trivia = false, unsigned threads = 0,
+        size_t chunk_size = size_t { 1 } << 16
+    );
+
+    /**
+     * @brief tokenize() into @p out, without materializing any ::token.
+     *
+     * The chunks are lexed into columns of their own and stitched into
+     * @p out, with keyword ids taken from the table of @p src.
+     */
+    static void tokenize(
+        const reader& src, token_columns& out, bool keep_trivia = false,
+        unsigned threads = 0, size_t chunk_size = size_t { 1 } << 16
+    );
+};
+
+#endif // LEXER_HPP
@@ -25,9 +25,15 @@
 #ifndef READER_HPP
 #define READER_HPP
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <source_location>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 /**
  * @brief Byte and line location within the input stream.
@@ -38,6 +44,34 @@ struct position {
     int column; ///< zero based column number
 };
 
+/**
+ * @brief Offsets at which the lines of a source text start.
+ *
+ * Built once with a vectorized newline scan; afterwards any offset can be
+ * turned into a line/column pair by binary search.
+ */
+class line_index {
+public:
+    line_index() = default;
+    explicit line_index(std::string_view text);
+
+    /**
+     * @brief Resolve @p offset into a full position.
+     * @param hint Line to try first; lookups that advance monotonically
+     *             through the text resolve in constant time.
+     */
+    [[nodiscard]] position locate(std::streamoff offset, int hint = 0) const;
+    [[nodiscard]] size_t lines() const noexcept;
+    /// Extend the index by @p text, which continues the indexed bytes.
+    void append(std::string_view text);
+    /// Number of bytes indexed so far.
+    [[nodiscard]] size_t size() const noexcept;
+
+private:
+    std::vector<size_t> starts { 0 };
+    size_t covered { 0 };
+};
+
 enum class token_kind {
     eof,
     open_bracket,
@@ -49,25 +83,163 @@ enum class token_kind {
     whitespace,
     integer,
     floating,
-    special_character
+    special_character,
+    /// text skipped by a recovering reader, see reader::set_diagnostics()
+    error
+};
+
+/**
+ * @brief Operator recognised by the reader.
+ *
+ * Operators are lexed by maximal munch, so <tt>a<<=b</tt> yields a single
+ * op_kind::shl_assign token. Special characters that are not operators keep
+ * op_kind::none; the ':' separator is op_kind::colon so the expression
+ * parser can close a ternary without comparing text.
+ */
+enum class op_kind : uint8_t {
+    none,
+    assign, ///< =
+    add_assign, ///< +=
+    sub_assign, ///< -=
+    mul_assign, ///< *=
+    div_assign, ///< /=
+    mod_assign, ///< %=
+    xor_assign, ///< ^=
+    or_assign, ///< |=
+    and_assign, ///< &=
+    shl_assign, ///< <<=
+    shr_assign, ///< >>=
+    logical_or, ///< ||
+    logical_and, ///< &&
+    bit_or, ///< |
+    bit_xor, ///< ^
+    bit_and, ///< &
+    equal, ///< ==
+    not_equal, ///< !=
+    less, ///< <
+    less_equal, ///< <=
+    greater, ///< >
+    greater_equal, ///< >=
+    shl, ///< <<
+    shr, ///< >>
+    plus, ///< +
+    minus, ///< -
+    star, ///< *
+    slash, ///< /
+    percent, ///< %
+    logical_not, ///< !
+    bit_not, ///< ~
+    increment, ///< ++
+    decrement, ///< --
+    question, ///< ?
+    colon ///< :, a separator token
+};
+
+/**
+ * @brief Value of a numeric literal, see token::number().
+ *
+ * Only the member matching the token kind is set. Literals that do not fit
+ * are flagged: integers saturate to UINT64_MAX, floating literals become
+ * infinity or zero.
+ */
+struct numeric_value {
+    uint64_t integer { 0 };
+    double floating { 0.0 };
+    bool out_of_range { false };
 };
 
+/**
+ * @brief Token as read from the source.
+ *
+ * Kept small: line and column are derived from @c offset through
+ * reader::lines(), numbers are parsed by number(), and keyword ids are
+ * kept by the token_stream and the AST.
+ */
 struct token final {
     token_kind kind;
-    position pos;
-    std::string word;
+    /// operator of a token_kind::special_character token
+    op_kind op { op_kind::none };
+    /// absolute offset from the beginning of the file
+    std::streamoff offset { 0 };
+    /**
+     * @brief Raw text of the token, viewed in place.
+     *
+     * Points into the reader's source (mapping, owned string or a stream
+     * chunk it retains), which must outlive the token. String literals are
+     * viewed without their quotes and with escape sequences left undecoded,
+     * see text().
+     */
+    std::string_view word;
 
     ~token();
 
+    /**
+     * @brief Materialize the token text.
+     *
+     * Escape sequences of string literals are decoded here; every other kind
+     * returns @c word as is.
+     */
+    [[nodiscard]] std::string text() const;
+    /// Parse the value of a token_kind::integer or token_kind::floating token.
+    [[nodiscard]] numeric_value number() const noexcept;
+
+    /// @param lines Index of the source, to print line and column.
     void dump(
-        std::ostream& os, const std::string& prefix, bool is_last
-    ) const noexcept;
+        std::ostream& os, const line_index& lines, const std::string& prefix,
+        bool is_last
+    ) const;
 
-    void dump(std::ostream& os) const noexcept;
+    void dump(std::ostream& os, const line_index& lines) const;
 };
 
 using token_ptr = std::shared_ptr<token>;
 
+/**
+ * @brief Strategy used by the reader to access a file.
+ */
+enum class input_mode {
+    mapped, ///< map the whole file read-only, fall back to stream if needed
+    stream ///< read the file through a buffered stream in fixed-size chunks
+};
+
+/// Error recorded by a recovering reader or grouper instead of thrown.
+struct diagnostic {
+    position pos;
+    std::string message;
+};
+
+/// Thrown by the reader; what() adds debugging context to @c message.
+struct reader_error : std::runtime_error {
+    reader_error(const std::string& what, std::string message, position pos);
+
+    /// the problem alone, as a recovering reader records it
+    std::string message;
+    /// where the reader was when it found the problem
+    position pos;
+};
+
+/**
+ * @brief Replacement of @c removed bytes at @c offset by @c inserted.
+ *
+ * Offsets are those of the source before the edit.
+ */
+struct text_edit {
+    size_t offset;
+    size_t removed;
+    std::string_view inserted;
+};
+
+/// Tag selecting the reader constructor that views a source it does not own.
+struct borrowed_source_t {
+    explicit borrowed_source_t() = default;
+};
+
+inline constexpr borrowed_source_t borrowed_source {};
+
+class token_stream;
+class bracket_index;
+class interner;
+
 /**
  * @brief Lightweight tokenizer for QuasiLang source code.
  *
@@ -77,12 +249,35 @@ using token_ptr = std::shared_ptr<token>;
  */
 class reader {
 public:
+    /**
+     * @brief Open @p path for tokenization.
+     *
+     * In input_mode::mapped regular files are memory-mapped and exposed as a
+     * single read-only span, so jump_to_position() is a pointer move and no
+     * bytes are copied. Pipes, character devices, empty files and platforms
+     * without mmap silently use the stream path, which reads @p buffer_size
+     * bytes at a time.
+     * @throw std::invalid_argument if the file cannot be opened or
+     *        @p buffer_size is not positive.
+     */
     explicit reader(
-        const std::filesystem::path& path, std::streamsize buffer_size = 4096
+        const std::filesystem::path& path, std::streamsize buffer_size = 4096,
+        input_mode mode = input_mode::mapped
     );
 
-    explicit reader(std::string& data) noexcept;
+    explicit reader(std::string& data);
+    /**
+     * @brief Tokenize @p source in place without taking ownership.
+     *
+     * The viewed bytes must outlive the reader and every token it produces.
+     */
+    reader(borrowed_source_t, std::string_view source);
 
+    // placeholders and tokens keep pointers into the reader and its input
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+    reader(reader&&) = delete;
+    reader& operator=(reader&&) = delete;
     ~reader();
     /**
      * @brief Read the next token from the input stream.
@@ -90,6 +285,13 @@ public:
      * @param out Token object to be filled with the parsed data.
      */
     void next_token(token& out);
+    /**
+     * @brief Advance past whitespace and comments without producing tokens.
+     *
+     * Line and column are kept exact, but no text is materialized, so a
+     * following next_token() always yields a significant token.
+     */
+    void skip_trivia();
 
     void jump_to_position(position pos);
     /**
@@ -101,15 +303,129 @@ public:
 
     position get_position() const;
 
+    /// True if the whole input is accessed through a memory mapping.
+    [[nodiscard]] bool is_mapped() const noexcept;
+    /// True unless the input is read through a stream chunk by chunk.
+    [[nodiscard]] bool is_resident() const noexcept;
+    /**
+     * @brief Whole input if it is resident (mapped file or in-memory data).
+     *
+     * Stream-backed readers only hold a chunk and return an empty view.
+     */
+    [[nodiscard]] std::string_view source() const noexcept;
+    /**
+     * @brief Line starts of the source, to turn token offsets into lines.
+     *
+     * Built on first use with a vectorized newline scan, and cached like
+     * tokens(). A stream-backed reader reads what it has read so far once
+     * more and extends the index with every chunk after that. From then on
+     * the reader no longer counts newlines while scanning and derives line
+     * and column of every position from the index instead.
+     */
+    [[nodiscard]] const line_index& lines();
+    /// Index built by lines() so far, or nullptr.
+    [[nodiscard]] const line_index* indexed() const noexcept;
+    /**
+     * @brief Compact token sequence of the resident source.
+     *
+     * Lexed on first use and cached, so every later parse of this reader
+     * (including placeholder expansion) only indexes into it. A source that
+     * does not lex is remembered as well, and later calls throw again
+     * without lexing.
+     * @throw std::runtime_error if the reader is stream-backed or the source
+     *        does not lex.
+     */
+    [[nodiscard]] const token_stream& tokens();
+    /// Stream built by tokens() so far, or nullptr.
+    [[nodiscard]] const token_stream* lexed() const noexcept;
+    /**
+     * @brief Matched brackets of the resident source.
+     *
+     * Built on first use from a vectorized scan that skips strings and
+     * comments without lexing, and cached like tokens().
+     * @throw std::runtime_error if the reader is stream-backed.
+     */
+    [[nodiscard]] const bracket_index& brackets();
+    /**
+     * @brief Apply @p edit to the resident source.
+     *
+     * The edited source is owned by the reader; a mapped file or borrowed
+     * source is copied in the process, with room to grow. While that room
+     * lasts the edit is made in place and source() keeps its address, so
+     * earlier tokens that end before the edit still view valid text. Any
+     * other token stops viewing valid text until relocate() points it into
+     * the new source. The cached token stream, bracket and line
+     * indexes are dropped and the reader is rewound to the start.
+     * @throw std::runtime_error if the reader is stream-backed or the edit
+     *        is out of range.
+     */
+    void edit(const text_edit& edit);
+    /**
+     * @brief View the text of @p t at its position in the current source.
+     *
+     * For tokens read before an edit() whose position has been moved
+     * along with the text; the text itself must be unchanged.
+     */
+    void relocate(token& t) const noexcept;
+    /**
+     * @brief Record lexical errors in @p sink instead of throwing them.
+     *
+     * The bytes from the start of a broken token up to the next <tt>;</tt>,
+     * <tt>}</tt> or line break are then returned as one token_kind::error
+     * token, and reading goes on after them. nullptr restores throwing.
+     */
+    void set_diagnostics(std::vector<diagnostic>* sink) noexcept;
+    [[nodiscard]] std::vector<diagnostic>* diagnostics() const noexcept;
+    /**
+     * @brief Table that ids the keyword tokens of this reader.
+     *
+     * Every reader starts with a table of its own, dropped with the reader.
+     */
+    [[nodiscard]] const std::shared_ptr<interner>& symbols() const noexcept;
+    /**
+     * @brief Id keywords in @p table from now on, e.g. to share one table
+     *        across the files of a build. @p table must not be null.
+     */
+    void set_symbols(std::shared_ptr<interner> table) noexcept;
+    /**
+     * @brief Keep every stream chunk a token was read from.
+     *
+     * On by default, so tokens of a stream-backed reader stay valid as long
+     * as the reader, like those of a resident source. Consumers that are
+     * done with each token before reading the next turn it off; the reader
+     * then holds a single chunk, and a token only stays valid until the
+     * next one is read.
+     */
+    void set_retain_chunks(bool retain) noexcept;
+
 private:
     std::ifstream ifs;
     std::string filename;
     std::string buffer;
+    std::unique_ptr<std::string> chunk;
+    /// earlier stream chunks that tokens still view into
+    std::vector<std::unique_ptr<std::string>> retained;
+    bool retain { true };
+    /// whether a token was read from the current chunk
+    bool viewed { false };
+    /// bytes currently addressable: the mapping, the owned string or a chunk
+    std::string_view input;
+    void* mapping { nullptr };
+    size_t mapping_size { 0 };
+    std::unique_ptr<line_index> index;
+    std::unique_ptr<token_stream> stream;
+    /// error of the failed tokens(), rethrown until the next edit
+    std::unique_ptr<std::runtime_error> lex_error;
+    std::unique_ptr<bracket_index> bracket_pairs;
     std::streamsize max_buffer_size {};
     std::streamoff file_offset {};
     int line { 0 };
     int column { 0 };
     size_t buffer_position { 0 };
+    /// start of the token being read, kept across stream chunk reloads
+    size_t token_start { std::string_view::npos };
+    std::vector<diagnostic>* sink { nullptr };
+    std::shared_ptr<interner> symbol_table;
 
     bool is_valid() const noexcept;
 
@@ -120,23 +436,40 @@ private:
     char get_char();
 
     void advance_char();
+    /// Consume @p length bytes of the current chunk, updating line/column.
+    void advance_run(size_t length);
+    /// Consume the run recognised by @p scan, across chunk reloads.
+    void read_run(size_t (*scan)(std::string_view) noexcept);
 
     void reload_buffer();
+    /// Index the stream input up to the end of the current chunk.
+    void extend_index();
+    /// Read one token, throwing on lexical errors.
+    void read_token(token& out);
+    /**
+     * @brief Turn the token that failed at @p at into an error token.
+     * @param error Exception thrown by read_token().
+     */
+    void recover(token& out, position at, const reader_error& error);
+
+    bool map_file(const std::filesystem::path& path);
 
-    void read_whitespace(std::string& into);
+    void read_whitespace();
 
-    void read_keyword(std::string& into);
+    void read_keyword();
     /**
      * @brief Read a quoted string literal with escape handling.
      *
      * Supports common escape sequences and Unicode escapes of the
-     * form <tt>\uXXXX</tt>. The resulting decoded text is stored in
-     * @p into without the surrounding quotes.
+     * form <tt>\uXXXX</tt>. Escapes are only validated here, decoding is
+     * deferred to token::text().
      * @throw std::runtime_error on malformed input.
      */
-    void read_string(std::string& into);
+    void read_string();
 
-    void read_comment(std::string& into);
+    void read_comment();
+    /// Read the longest operator starting at the current character.
+    op_kind read_operator();
     /**
      * @brief Parse an integer or floating point literal.
      *
@@ -144,16 +477,18 @@ private:
      * fractional part or exponent is present the returned kind is
      * token_kind::floating.
      */
-    token_kind read_number(std::string& into);
+    token_kind read_number();
+
+    void init_token(token& t) noexcept;
 
-    void init_token(token& t) const noexcept;
+    void finish_token(token& t) noexcept;
     /**
-     * @brief Helper to create formatted runtime errors.
+     * @brief Helper to create formatted reader errors.
      *
      * In debug builds the message includes context information such
      * as the current position and originating source location.
      */
-    [[nodiscard]] std::runtime_error make_error(
+    [[nodiscard]] reader_error make_error(
         const std::string& message,
         const std::source_location& location = std::source_location::current()
     ) const;
@@ -0,0 +1,83 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Instruction set used by the scanner kernels.
+ */
+enum class scan_kernel {
+    scalar, ///< portable byte-by-byte loop
+    sse2, ///< 16 bytes per step
+    avx2 ///< 32 bytes per step
+};
+
+/**
+ * @brief Vectorized character-class scanning for the reader hot loops.
+ *
+ * Every function looks at the beginning of @p text and returns the length of
+ * the longest prefix whose bytes belong to the class. Classes follow the "C"
+ * locale, so bytes outside of ASCII never match. The fastest kernel supported
+ * by the CPU is selected on first use.
+ */
+class scanner {
+public:
+    /// Run of ' ', '\t', '\n', '\v', '\f' and '\r'.
+    static size_t whitespace_run(std::string_view text) noexcept;
+    /// Run of letters, digits and underscores.
+    static size_t identifier_run(std::string_view text) noexcept;
+    /// Run of decimal digits.
+    static size_t digit_run(std::string_view text) noexcept;
+    /// Number of '\n' bytes in @p text.
+    static size_t count_newlines(std::string_view text) noexcept;
+    /**
+     * @brief Append the offset following every '\n' in @p text to @p into.
+     * @param base Offset of @p text in the whole source.
+     */
+    static void line_starts(
+        std::string_view text, std::vector<size_t>& into, size_t base = 0
+    );
+    /**
+     * @brief Append the offset of every structural byte in @p text to @p into.
+     *
+     * Structural bytes are the brackets <tt>()[]{}</tt>, both quotes and
+     * '/', which is all a bracket matcher needs to see to skip strings and
+     * comments.
+     */
+    static void structural(std::string_view text, std::vector<size_t>& into);
+
+    [[nodiscard]] static scan_kernel active_kernel() noexcept;
+    /**
+     * @brief Force a kernel, e.g. to compare implementations.
+     * @return false if the CPU does not support @p kernel.
+     */
+    static bool use_kernel(scan_kernel kernel) noexcept;
+};
+
+#endif // SCANNER_HPP
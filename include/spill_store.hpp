@@ -0,0 +1,80 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SPILL_STORE_HPP
+#define SPILL_STORE_HPP
+
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include "flat_tree.hpp"
+
+/**
+ * @brief Temporary file holding serialized placeholder subtrees.
+ *
+ * Once a placeholder has been expanded, its identified subtree is written
+ * here as a flat_tree, keyed by the region of the placeholder. Later
+ * expansions reload it instead of re-running the grouper. Like
+ * ::subtree_cache, one store serves the placeholders of a single reader.
+ * The file is removed when the store is destroyed.
+ */
+class spill_store {
+public:
+    /// @throw std::runtime_error if no temporary file can be created.
+    spill_store();
+
+    /**
+     * @brief Subtree spilled for the region @p key, if any; counts a reload.
+     *
+     * Its keywords are id'd in @p symbols, see flat_tree::deserialize().
+     */
+    [[nodiscard]] std::optional<flat_tree>
+    load(const subtree_key& key, interner& symbols);
+    void store(const subtree_key& key, const flat_tree& tree);
+    /// Forget all subtrees; their space in the file is reused.
+    void clear() noexcept;
+
+    /// Number of spilled subtrees.
+    [[nodiscard]] size_t size() const noexcept;
+    /// Bytes written to the file.
+    [[nodiscard]] size_t bytes() const noexcept;
+    /// Number of subtrees load() found.
+    [[nodiscard]] size_t reloads() const noexcept;
+
+private:
+    struct record {
+        long offset;
+        size_t length;
+    };
+
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file;
+    long tail { 0 };
+    size_t reload_count { 0 };
+    std::unordered_map<subtree_key, record, subtree_key_hash> records;
+};
+
+#endif // SPILL_STORE_HPP
@@ -0,0 +1,83 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SUBTREE_CACHE_HPP
+#define SUBTREE_CACHE_HPP
+
+#include <list>
+#include <unordered_map>
+
+#include "ast.hpp"
+
+/**
+ * @brief Byte-budgeted LRU cache of expanded placeholder subtrees.
+ *
+ * Entries are keyed by the region of the placeholder, see ::subtree_key,
+ * so one cache serves the placeholders of a single reader. Each entry is
+ * charged the arena bytes of its subtree; the least recently used entries
+ * are dropped once the budget is exceeded. Dropped subtrees stay alive as
+ * long as a caller still holds their root.
+ */
+class subtree_cache {
+public:
+    explicit subtree_cache(size_t budget);
+
+    /// Cached subtree of the region @p key, or nullptr; counts a hit/miss.
+    [[nodiscard]] ast_root find(const subtree_key& key);
+    /**
+     * @brief Remember @p root as the subtree of the region @p key.
+     *
+     * Subtrees larger than the whole budget are not cached.
+     */
+    void insert(const subtree_key& key, ast_root root, size_t bytes);
+    void clear() noexcept;
+
+    [[nodiscard]] size_t hits() const noexcept;
+    [[nodiscard]] size_t misses() const noexcept;
+    /// Number of cached subtrees.
+    [[nodiscard]] size_t size() const noexcept;
+    /// Bytes charged to the cached subtrees.
+    [[nodiscard]] size_t bytes() const noexcept;
+    [[nodiscard]] size_t budget() const noexcept;
+
+private:
+    struct entry {
+        subtree_key key;
+        ast_root root;
+        size_t bytes;
+    };
+
+    size_t capacity;
+    size_t used { 0 };
+    size_t hit_count { 0 };
+    size_t miss_count { 0 };
+    /// most recently used first
+    std::list<entry> entries;
+    std::unordered_map<
+        subtree_key, std::list<entry>::iterator, subtree_key_hash>
+        index;
+};
+
+#endif // SUBTREE_CACHE_HPP
@@ -71,10 +71,10 @@ struct token {
      */
     virtual void dump(
         std::ostream& os, const std::string& prefix, bool is_last
-    ) const noexcept;
+    ) const;
 
     /// Convenience wrapper around dump(os, "", true)
-    void dump(std::ostream& os) const noexcept;
+    void dump(std::ostream& os) const;
 };
 
 using token_ptr = std::shared_ptr<token>;
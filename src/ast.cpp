@@ -24,13 +24,173 @@
 
 #include "ast.hpp"
 
+#include "interner.hpp"
+#include "spill_store.hpp"
+#include "subtree_cache.hpp"
+
+#include <algorithm>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define QPILER_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define QPILER_ASAN 1
+#endif
+#endif
+#ifdef QPILER_ASAN
+#include <sanitizer/asan_interface.h>
+#else
+#define ASAN_POISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+#define ASAN_UNPOISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+#endif
+
+ast_arena::~ast_arena() {
+    for (auto it = owned.rbegin(); it != owned.rend(); ++it) {
+        if (*it != nullptr) {
+            (*it)->~ast_node();
+        }
+    }
+}
+
+void* ast_arena::allocate(const size_t size, const size_t align) {
+    for (auto& memory : spare) {
+        if (memory.size == size && memory.align == align
+            && !memory.free.empty()) {
+            void* reused = memory.free.back();
+            memory.free.pop_back();
+            ASAN_UNPOISON_MEMORY_REGION(reused, size);
+            used_bytes += size;
+            return reused;
+        }
+    }
+    auto space = static_cast<size_t>(tail - head);
+    void* memory = head;
+    if (head == nullptr || !std::align(align, size, memory, space)) {
+        const size_t bytes = std::max(block_size, size + align);
+        blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes));
+        head = blocks.back().get();
+        tail = head + bytes;
+        space = bytes;
+        memory = head;
+        std::align(align, size, memory, space);
+    }
+    head = static_cast<std::byte*>(memory) + size;
+    used_bytes += size;
+    return memory;
+}
+
+size_t ast_arena::reserve_slot() {
+    size_t slot = owned.size();
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        owned.emplace_back();
+    }
+    ++live;
+    return slot;
+}
+
+bool ast_arena::destroy(const ast_node& node) {
+    if (node.slot >= owned.size() || owned[node.slot] != &node) {
+        return std::any_of(
+            adopted.begin(), adopted.end(),
+            [&node](const auto& other) { return other->destroy(node); }
+        );
+    }
+    const auto [size, align]
+        = visit_node(node, []<typename N>(const N&) {
+              return std::pair { sizeof(N), alignof(N) };
+          });
+    auto it = std::find_if(
+        spare.begin(), spare.end(),
+        [size, align](const spare_memory& memory) {
+            return memory.size == size && memory.align == align;
+        }
+    );
+    if (it == spare.end()) {
+        it = spare.insert(spare.end(), { size, align, {} });
+    }
+    // both lists grow before the node goes, so a failure leaves it alive
+    auto* memory = const_cast<ast_node*>(&node);
+    it->free.push_back(memory);
+    try {
+        free_slots.push_back(node.slot);
+    } catch (...) {
+        it->free.pop_back();
+        throw;
+    }
+    owned[node.slot] = nullptr;
+    memory->~ast_node();
+    // released memory is off limits until allocate() hands it out again
+    ASAN_POISON_MEMORY_REGION(memory, size);
+    used_bytes -= size;
+    --live;
+    return true;
+}
+
+void ast_arena::release(const ast_node& root) {
+    // children are collected before their parent is destroyed
+    std::vector<const ast_node*> pending { &root };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+        destroy(*node);
+    }
+}
+
+void ast_arena::release_node(const ast_node& node) { destroy(node); }
+
+void ast_arena::adopt(std::shared_ptr<ast_arena> other) {
+    adopted.push_back(std::move(other));
+}
+
+void ast_arena::adopt(std::shared_ptr<group_node> root) {
+    trees.push_back(std::move(root));
+}
+
+size_t ast_arena::used() const noexcept {
+    size_t total = used_bytes;
+    for (const auto& other : adopted) {
+        total += other->used();
+    }
+    return total;
+}
+
+size_t ast_arena::size() const noexcept {
+    size_t total = live;
+    for (const auto& other : adopted) {
+        total += other->size();
+    }
+    return total;
+}
+
+void ast_arena::charge(ast_node& node, const size_t own) noexcept {
+    size_t text = 0;
+    visit_node(node, [&text]<typename N>(const N& n) {
+        if constexpr (std::is_base_of_v<token_node, N>) {
+            text = n.value.word.size();
+        } else if constexpr (std::is_same_v<ternary_node, N>) {
+            text = n.qmark.word.size() + n.colon.word.size();
+        } else if constexpr (std::is_base_of_v<group_node, N>) {
+        } else if constexpr (!std::is_same_v<ast_node, N>) {
+            text = n.op.word.size();
+        }
+    });
+    node.fixed_bytes += own + text;
+    node.full_bytes += own + text;
+}
+
 ast_node::~ast_node() = default;
 
 ast_node const* ast_node::get() const noexcept { return this; }
 
 ast_node const* ast_node::first() const { return this; }
 
-const position& ast_node::get_start() const {
+std::streamoff ast_node::get_start() const {
     throw std::runtime_error(
         "get_start() is not implemented for ast_node, use derived classes"
     );
@@ -39,27 +199,41 @@ const position& ast_node::get_start() const {
 bool ast_node::empty() const noexcept { return true; }
 
 void ast_node::dump(
-    std::ostream& os, const std::string& prefix, const bool is_last, bool
+    std::ostream& os, const line_index&, const std::string& prefix,
+    const bool is_last, bool
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "Null\n";
 }
 
-void ast_node::dump(std::ostream& os, const bool full) const {
-    dump(os, "", true, full);
+void ast_node::dump(
+    std::ostream& os, const line_index& lines, const bool full
+) const {
+    dump(os, lines, "", true, full);
+}
+
+void ast_node::dump(std::ostream& os, const line_index& lines) const {
+    dump(os, lines, true);
 }
 
-void ast_node::dump(std::ostream& os) const { dump(os, true); }
+token_node::token_node() noexcept { tag = node_kind::token; }
+
+token_node::token_node(const token& value, const uint32_t symbol)
+    : value(value)
+    , symbol(symbol) {
+    tag = node_kind::token;
+}
 
 bool token_node::empty() const noexcept { return false; }
 
-const position& token_node::get_start() const { return value.pos; }
+std::streamoff token_node::get_start() const { return value.offset; }
 
 void token_node::dump(
-    std::ostream& os, const std::string& prefix, const bool, bool
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    const bool, bool
 ) const {
     // os << prefix << (is_last ? "`-" : "|-") << "TokenNode\n";
     // value.dump(os, prefix + (is_last ? "  " : "| "), true);
-    value.dump(os, prefix, true);
+    value.dump(os, lines, prefix, true);
 }
 
 const char* group_kind_name(group_kind k) noexcept {
@@ -69,52 +243,383 @@ const char* group_kind_name(group_kind k) noexcept {
     return names[static_cast<size_t>(k)];
 }
 
-void placeholder_node::dump(
-    std::ostream& os, const std::string& prefix, const bool is_last,
-    const bool full
-) const {
-    if (full && src != nullptr) {
-        const auto position = src->get_position();
-        src->jump_to_position(start);
-        grouper g { *src, limit };
+size_t subtree_key_hash::operator()(const subtree_key& key) const noexcept {
+    size_t seed = 0;
+    const auto mix = [&seed](const size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+    };
+    mix(static_cast<size_t>(key.offset));
+    mix(static_cast<size_t>(key.end));
+    mix(static_cast<size_t>(key.kind));
+    mix(key.limit);
+    mix(key.byte_limit);
+    mix(key.lazy_depth);
+    return seed;
+}
+
+placeholder_node::placeholder_node() noexcept {
+    tag = node_kind::placeholder;
+}
+
+subtree_key placeholder_node::key() const noexcept {
+    return { start, end, kind, limit, byte_limit, lazy_depth };
+}
+
+ast_root placeholder_node::expand() const {
+    if (src == nullptr) {
+        throw std::runtime_error(
+            "[PlaceholderNode-Error] placeholder has no source to expand"
+        );
+    }
+    if (cache != nullptr) {
+        if (auto hit = cache->find(key())) {
+            return hit;
+        }
+    }
+    if (spill != nullptr) {
+        if (const auto tree = spill->load(key(), *src->symbols())) {
+            auto group = tree->inflate(*this);
+            if (cache != nullptr) {
+                cache->insert(key(), group, group->fixed_bytes);
+            }
+            return group;
+        }
+    }
+    size_t bytes = 0;
+    auto group = regroup(&bytes);
+    if (spill != nullptr) {
+        spill->store(key(), flat_tree { *group });
+    }
+    if (cache != nullptr) {
+        cache->insert(key(), group, bytes);
+    }
+    return group;
+}
+
+ast_root placeholder_node::regroup(size_t* bytes) const {
+    if (src == nullptr) {
+        throw std::runtime_error(
+            "[PlaceholderNode-Error] placeholder has no source to expand"
+        );
+    }
+    const auto position = src->get_position();
+    const auto reported = static_cast<std::ptrdiff_t>(
+        diagnostics != nullptr ? diagnostics->size() : 0
+    );
+    ast_root group;
+    std::string error;
+    // the parse that squeezed the region may have held more of the tree,
+    // so a budget it met might only be met again by squeezing everything
+    for (const bool eager : { false, true }) {
+        src->jump_to_position({ start, 0, 0 });
+        grouper g = byte_limit != 0
+            ? grouper { *src, memory_budget { byte_limit }, cache, spill }
+            : grouper { *src, limit, cache, spill };
+        g.set_lazy_depth(lazy_depth);
+        g.set_eager_squeeze(eager);
+        // placeholders of the region report to the same sink
+        g.set_diagnostics(diagnostics);
         try {
-            auto group = g.parse(kind);
-            group->dump(os, prefix, is_last, full);
+            group = g.parse(kind);
+            if (bytes != nullptr) {
+                *bytes = g.arena_bytes();
+            }
+            break;
         } catch (const std::runtime_error& e) {
-            src->jump_to_position(start);
-            token current;
-            src->next_token(current);
-            std::ostringstream msg;
-            msg << "[PlaceholderNode-Error] during parsing at position <"
-                << position.line << ":" << position.column
-                << "> with first token: ";
-            current.dump(msg);
-            msg << prefix << e.what() << "\n";
-            throw std::runtime_error(msg.str());
+            if (error.empty()) {
+                error = e.what();
+            }
+            if (diagnostics != nullptr) {
+                diagnostics->erase(
+                    diagnostics->begin() + reported, diagnostics->end()
+                );
+            }
+            if (eager || byte_limit == 0) {
+                src->jump_to_position({ start, 0, 0 });
+                token current;
+                src->next_token(current);
+                const auto& lines = src->lines();
+                const auto at = lines.locate(start);
+                std::ostringstream msg;
+                msg << "[PlaceholderNode-Error] during parsing at position <"
+                    << at.line << ":" << at.column << "> with first token: ";
+                current.dump(msg, lines);
+                msg << error << "\n";
+                throw std::runtime_error(msg.str());
+            }
         }
-        src->jump_to_position(position);
+    }
+    src->jump_to_position(position);
+    if (diagnostics != nullptr) {
+        // errors of the grouping were reported by the parse that squeezed
+        // the region, and so were those of an earlier expansion
+        const auto known = diagnostics->begin() + reported;
+        diagnostics->erase(
+            std::remove_if(
+                known, diagnostics->end(),
+                [&](const diagnostic& d) {
+                    return std::any_of(
+                        diagnostics->begin(), known,
+                        [&d](const diagnostic& other) {
+                            return other.pos.offset == d.pos.offset
+                                && other.message == d.message;
+                        }
+                    );
+                }
+            ),
+            diagnostics->end()
+        );
+    }
+    return group;
+}
+
+void placeholder_node::dump(
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    const bool is_last, const bool full
+) const {
+    if (full && src != nullptr) {
+        expand()->dump(os, lines, prefix, is_last, full);
     } else {
         os << prefix << (is_last ? "`-" : "|-") << "Placeholder("
-           << group_kind_name(kind) << ") [" << full_size << " nested nodes]\n";
+           << group_kind_name(kind) << ") [";
+        if (parsed) {
+            os << full_size << " nested nodes]\n";
+        } else {
+            os << "not parsed]\n";
+        }
+    }
+}
+
+group_node::group_node() noexcept { tag = node_kind::group; }
+
+/// node whose offset first_offset() reports, null if none
+static const ast_node* leftmost_node(const ast_node& node) noexcept {
+    const ast_node* found = nullptr;
+    for (const ast_node* next = &node; next != nullptr;) {
+        next = visit_node(
+            *next, [&found]<typename N>(const N& n) -> const ast_node* {
+                if constexpr (std::is_base_of_v<token_node, N>
+                              || std::is_base_of_v<wrapped_node, N>) {
+                    found = &n;
+                } else if constexpr (std::is_same_v<group_node, N>) {
+                    return n.nodes.empty() ? nullptr : n.nodes.front().get();
+                } else if constexpr (std::is_same_v<unary_node, N>) {
+                    if (!n.is_prefix) {
+                        return n.expr.get();
+                    }
+                    found = &n;
+                } else if constexpr (std::is_same_v<binary_node, N>) {
+                    return n.lhs.get();
+                } else if constexpr (std::is_same_v<ternary_node, N>) {
+                    return n.cond.get();
+                }
+                return nullptr;
+            }
+        );
     }
+    return found;
+}
+
+/// offset the parse of a squeezed group restarts from, null if none
+static const std::streamoff* squeeze_start(const group_node& group) noexcept {
+    const ast_node* found = &group;
+    if (isa<wrapped_node>(&group)) {
+        if (group.nodes.empty()) {
+            return nullptr;
+        }
+        found = group.nodes[0].get();
+    }
+    found = leftmost_node(*found);
+    // a placeholder of brackets starts inside them, the bracket is unknown
+    if (isa<placeholder_node>(found)) {
+        const auto kind = static_cast<const placeholder_node*>(found)->kind;
+        if (kind == group_kind::body || kind == group_kind::list
+            || kind == group_kind::paren) {
+            return nullptr;
+        }
+    }
+    return found != nullptr ? first_offset(*found) : nullptr;
+}
+
+/// whether else, elif, catch or finally joined @p group to a command before
+static bool joined_command(const group_node& group) noexcept {
+    if (group.kind != group_kind::command) {
+        return false;
+    }
+    return std::any_of(
+        group.nodes.begin() + 1, group.nodes.end(),
+        [](const ast_node_ptr& node) {
+            if (!isa<control_node>(node)) {
+                return false;
+            }
+            const auto& ctrl = static_cast<const control_node&>(*node);
+            switch (static_cast<reserved>(ctrl.symbol)) {
+            case reserved::kw_else:
+            case reserved::kw_elif:
+            case reserved::kw_catch:
+            case reserved::kw_finally:
+                return true;
+            default:
+                return false;
+            }
+        }
+    );
 }
 
-void group_node::append(ast_node_ptr node, const reader& src) {
+bool squeezable(const group_node& group) noexcept {
+    // a parse of the region would stop at the first command of the chain
+    return !group.nodes.empty() && !joined_command(group)
+        && squeeze_start(group) != nullptr;
+}
+
+/// Put a placeholder in @p slot, returning the group it held still alive.
+static group_ptr collapse(
+    ast_node_ptr& slot, const squeeze_context& context, ast_arena& arena
+) {
+    auto group = node_cast<group_node>(slot);
+    if (group->nodes.empty()) {
+        throw std::runtime_error("cannot squeeze empty group node");
+    }
+    if (!squeezable(*group)) {
+        throw std::runtime_error(
+            "cannot squeeze group node, its region does not parse on its own"
+        );
+    }
+    const auto* first = squeeze_start(*group);
+    const auto ph = arena.make<placeholder_node>();
+    ph->src = context.src;
+    ph->cache = context.cache;
+    ph->spill = context.spill;
+    ph->diagnostics = context.diagnostics;
+    ph->limit = group->limit;
+    ph->byte_limit = group->byte_limit;
+    ph->kind = group->kind;
+    ph->start = *first;
+    if (auto wn = node_cast<wrapped_node>(group)) {
+        ph->end = wn->end;
+    }
+    ph->full_size = group->full_size;
+    ph->fixed_size = 1;
+    ph->full_bytes = group->full_bytes;
+    slot = ph;
+    return group;
+}
+
+/**
+ * @brief Squeeze the heaviest bracket that @p node holds, such as the body
+ * of a function.
+ *
+ * The counters of @p node and of the nodes in between shrink accordingly.
+ * @return the squeezed group, still alive, or null if there is none.
+ */
+static group_ptr collapse_below(
+    ast_node& node, const squeeze_context& context, ast_arena& arena
+) {
+    constexpr size_t none = std::numeric_limits<size_t>::max();
+    struct holder {
+        ast_node* node;
+        size_t owner;
+    };
+    std::vector<holder> holders { { &node, none } };
+    ast_node_ptr* heaviest = nullptr;
+    size_t owner = none;
+    size_t weight = 0;
+    for (size_t i = 0; i < holders.size(); ++i) {
+        for_each_child_slot(*holders[i].node, [&](ast_node_ptr& child) {
+            // only a bracket ends where a parse of its region would
+            if (!isa<wrapped_node>(child)) {
+                holders.push_back({ child.get(), i });
+            } else if (!isa<placeholder_node>(child)
+                       && child->fixed_bytes > weight
+                       && squeezable(static_cast<group_node&>(*child))) {
+                heaviest = &child;
+                owner = i;
+                weight = child->fixed_bytes;
+            }
+        });
+    }
+    if (heaviest == nullptr) {
+        return {};
+    }
+    const auto group = collapse(*heaviest, context, arena);
+    // deltas wrap around like the counters they are added to
+    const size_t size = (*heaviest)->fixed_size - group->fixed_size;
+    const size_t bytes = (*heaviest)->fixed_bytes - group->fixed_bytes;
+    for (size_t i = owner; i != none; i = holders[i].owner) {
+        holders[i].node->fixed_size += size;
+        holders[i].node->fixed_bytes += bytes;
+    }
+    return group;
+}
+
+void group_node::append(
+    ast_node_ptr node, const squeeze_context& context, ast_arena& arena
+) {
     size_t exclude = (size() == 0 ? 1 : 0);
     fixed_size += node->fixed_size - exclude;
     full_size += node->full_size - exclude;
-    if (node->fixed_size > 1 && std::dynamic_pointer_cast<group_node>(node)) {
-        weights.emplace(node->fixed_size, size());
+    fixed_bytes += node->fixed_bytes + sizeof(ast_node_ptr);
+    full_bytes += node->full_bytes + sizeof(ast_node_ptr);
+    const bool by_bytes = byte_limit != 0;
+    const bool heavy = by_bytes
+        ? !node->empty() && !isa<placeholder_node>(node)
+        : node->fixed_size > 1;
+    const auto group = node_cast<group_node>(node);
+    // a region without tokens could not be parsed again; by bytes, nodes
+    // such as functions and loops give up the groups they hold
+    if (heavy
+        && (group ? squeezable(*group)
+                  : by_bytes && node->tag != node_kind::token)) {
+        weights.emplace(
+            by_bytes ? node->fixed_bytes : node->fixed_size, size()
+        );
     }
     nodes.push_back(std::move(node));
-    while (!weights.empty() && fixed_size > limit) {
-        auto [weight, index] = weights.top();
+    const auto over = [&] {
+        if (!by_bytes) {
+            return fixed_size > limit;
+        }
+        // the arena also holds the groups still being built
+        return fixed_bytes > byte_limit
+            || (context.arena_limit != 0
+                && arena.used() > context.arena_limit);
+    };
+    // the new node outlives a failure below, the caller may report it
+    group_ptr appended;
+    while (!weights.empty() && over()) {
+        const size_t index = weights.top().second;
         weights.pop();
-        fixed_size += 1 - weight;
-        if (!std::dynamic_pointer_cast<placeholder_node>(nodes[index])) {
-            squeeze(index, src);
+        auto& child = nodes[index];
+        if (isa<placeholder_node>(child)) {
+            continue;
+        }
+        const size_t size = child->fixed_size;
+        const size_t bytes = child->fixed_bytes;
+        group_ptr squeezed;
+        if (isa<group_node>(child)) {
+            squeezed = collapse(child, context, arena);
+            if (index + 1 == nodes.size()) {
+                appended = squeezed;
+            }
+        } else if ((squeezed = collapse_below(*child, context, arena))) {
+            // it may hold more groups to give up
+            weights.emplace(child->fixed_bytes, index);
+        } else {
+            continue;
+        }
+        fixed_size += child->fixed_size - size;
+        fixed_bytes += child->fixed_bytes - bytes;
+        if (squeezed != appended) {
+            arena.release(*squeezed);
         }
     }
+    if (by_bytes && fixed_bytes > byte_limit) {
+        throw budget_exceeded(
+            "memory budget is too small for group node (required "
+            + std::to_string(fixed_bytes) + " bytes, budget is "
+            + std::to_string(byte_limit) + ")"
+        );
+    }
     if (fixed_size > limit) {
         throw std::runtime_error(
             "limit is too small for group node (required "
@@ -122,6 +627,9 @@ void group_node::append(ast_node_ptr node, const reader& src) {
             + ")"
         );
     }
+    if (appended) {
+        arena.release(*appended);
+    }
 }
 
 bool group_node::empty() const noexcept { return size() == 0; }
@@ -143,8 +651,8 @@ ast_node const* group_node::first() const {
 }
 
 void group_node::dump(
-    std::ostream& os, const std::string& prefix, const bool is_last,
-    const bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    const bool is_last, const bool full
 ) const {
     if (kind != group_kind::file) {
         os << prefix << (is_last ? "`-" : "|-");
@@ -157,11 +665,11 @@ void group_node::dump(
     const std::string child_prefix
         = prefix + (kind != group_kind::file ? (is_last ? "  " : "| ") : "");
     for (size_t i = 0; i < nodes.size(); ++i) {
-        nodes[i]->dump(os, child_prefix, i + 1 == nodes.size(), full);
+        nodes[i]->dump(os, lines, child_prefix, i + 1 == nodes.size(), full);
     }
 }
 
-const position& group_node::get_start() const {
+std::streamoff group_node::get_start() const {
     if (size() == 0) {
         throw std::runtime_error(
             "group node is empty, cannot get start position"
@@ -170,36 +678,30 @@ const position& group_node::get_start() const {
     return nodes[0]->get_start();
 }
 
-void group_node::squeeze(const size_t index, const reader& src) {
+void group_node::squeeze(
+    const size_t index, const squeeze_context& context, ast_arena& arena
+) {
     if (index >= nodes.size()) {
         throw std::out_of_range("index out of range for group node");
     }
-    auto group = std::dynamic_pointer_cast<group_node>(nodes[index]);
-    if (!group) {
+    if (!isa<group_node>(nodes[index])) {
         std::stringstream ss;
-        nodes[index]->dump(ss, "\t", true, true);
+        const auto* lines
+            = context.src != nullptr ? context.src->indexed() : nullptr;
+        if (lines != nullptr) {
+            nodes[index]->dump(ss, *lines, "\t", true, true);
+        }
         throw std::runtime_error(
             "node at index " + std::to_string(index)
             + " is not a group node: \n" + ss.str()
         );
     }
-    if (group->nodes.empty()) {
-        throw std::runtime_error(
-            "cannot squeeze empty group node at index " + std::to_string(index)
-        );
-    }
-    const auto ph = std::make_shared<placeholder_node>();
-    ph->src = const_cast<reader*>(&src);
-    ph->limit = group->limit;
-    ph->kind = group->kind;
-    if (auto wn = std::dynamic_pointer_cast<wrapped_node>(group)) {
-        ph->start = wn->nodes[0]->get_start();
-    } else {
-        ph->start = group->get_start();
-    }
-    ph->full_size = group->full_size;
-    ph->fixed_size = 1;
-    nodes[index] = ph;
+    const size_t size = nodes[index]->fixed_size;
+    const size_t bytes = nodes[index]->fixed_bytes;
+    const auto group = collapse(nodes[index], context, arena);
+    fixed_size += nodes[index]->fixed_size - size;
+    fixed_bytes += nodes[index]->fixed_bytes - bytes;
+    arena.release(*group);
 }
 
 void group_node::pop_back() {
@@ -208,6 +710,8 @@ void group_node::pop_back() {
     }
     fixed_size -= nodes.back()->fixed_size;
     full_size -= nodes.back()->full_size;
+    fixed_bytes -= nodes.back()->fixed_bytes + sizeof(ast_node_ptr);
+    full_bytes -= nodes.back()->full_bytes + sizeof(ast_node_ptr);
     nodes.pop_back();
     if (nodes.empty()) {
         fixed_size = 1;
@@ -215,35 +719,55 @@ void group_node::pop_back() {
     }
 }
 
-const position& wrapped_node::get_start() const { return start; }
+void group_node::clear() {
+    while (!nodes.empty()) {
+        pop_back();
+    }
+    weights = {};
+}
+
+wrapped_node::wrapped_node() noexcept { tag = node_kind::wrapped; }
+
+std::streamoff wrapped_node::get_start() const { return start; }
 
-callexp_node::callexp_node(const token& name) { value = name; }
+callexp_node::callexp_node(const token& name, const uint32_t symbol)
+    : token_node(name, symbol) {
+    tag = node_kind::callexp;
+}
 
 void callexp_node::set_paren(ast_node_ptr p) {
     paren = std::move(p);
     has_paren = true;
     fixed_size += paren->fixed_size;
     full_size += paren->full_size;
+    fixed_bytes += paren->fixed_bytes;
+    full_bytes += paren->full_bytes;
 }
 
 void callexp_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "CallExpr\n";
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-    value.dump(os, child_prefix, !has_paren);
+    value.dump(os, lines, child_prefix, !has_paren);
     if (has_paren) {
-        paren->dump(os, child_prefix, true, full);
+        paren->dump(os, lines, child_prefix, true, full);
     }
 }
 
 fundecl_node::fundecl_node(const callexp_ptr& proto)
-    : callexp_node(proto ? proto->value : token {}) {
+    : callexp_node(proto ? proto->value : token {}, proto ? proto->symbol : 0) {
+    tag = node_kind::fundecl;
     if (proto) {
         has_paren = proto->has_paren;
         paren = proto->paren;
         fixed_size = proto->fixed_size;
         full_size = proto->full_size;
+        if (has_paren) {
+            fixed_bytes = paren->fixed_bytes;
+            full_bytes = paren->full_bytes;
+        }
     }
 }
 
@@ -252,33 +776,42 @@ void fundecl_node::set_body(ast_node_ptr b) {
     has_body = true;
     fixed_size += body->fixed_size;
     full_size += body->full_size;
+    fixed_bytes += body->fixed_bytes;
+    full_bytes += body->full_bytes;
 }
 
 void fundecl_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "FunctionDecl\n";
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-    value.dump(os, child_prefix, !(has_paren || has_body));
+    value.dump(os, lines, child_prefix, !(has_paren || has_body));
     if (has_paren) {
-        paren->dump(os, child_prefix, !has_body, full);
+        paren->dump(os, lines, child_prefix, !has_body, full);
     }
     if (has_body) {
-        body->dump(os, child_prefix, true, full);
+        body->dump(os, lines, child_prefix, true, full);
     }
 }
 
-control_node::control_node(const token& name) { value = name; }
+control_node::control_node(const token& name, const uint32_t symbol)
+    : token_node(name, symbol) {
+    tag = node_kind::control;
+}
 
 void control_node::set_body(ast_node_ptr b) {
     body = std::move(b);
     has_body = true;
     fixed_size += body->fixed_size;
     full_size += body->full_size;
+    fixed_bytes += body->fixed_bytes;
+    full_bytes += body->full_bytes;
 }
 
 void control_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "Control(" << value.word << ")";
     if (!full) {
@@ -287,15 +820,15 @@ void control_node::dump(
     os << '\n';
     if (has_body) {
         const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-        body->dump(os, child_prefix, true, full);
+        body->dump(os, lines, child_prefix, true, full);
     }
 }
 
-condition_node::condition_node(const token& name)
-    : control_node(name) {
-    if (name.word == "for" || name.word == "while") {
-        is_loop = true;
-    }
+condition_node::condition_node(const token& name, const uint32_t symbol)
+    : control_node(name, symbol) {
+    tag = node_kind::condition;
+    const auto kw = static_cast<reserved>(symbol);
+    is_loop = kw == reserved::kw_for || kw == reserved::kw_while;
 }
 
 void condition_node::set_paren(ast_node_ptr p) {
@@ -303,10 +836,13 @@ void condition_node::set_paren(ast_node_ptr p) {
     has_paren = true;
     fixed_size += paren->fixed_size;
     full_size += paren->full_size;
+    fixed_bytes += paren->fixed_bytes;
+    full_bytes += paren->full_bytes;
 }
 
 void condition_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << (is_loop ? "Loop" : "Condition")
        << '(' << value.word << ")";
@@ -316,20 +852,23 @@ void condition_node::dump(
     os << '\n';
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
     if (has_paren) {
-        paren->dump(os, child_prefix, !has_body, full);
+        paren->dump(os, lines, child_prefix, !has_body, full);
     }
     if (has_body) {
-        body->dump(os, child_prefix, true, full);
+        body->dump(os, lines, child_prefix, true, full);
     }
 }
 
-jump_node::jump_node(const token& name)
-    : control_node(name) { }
+jump_node::jump_node(const token& name, const uint32_t symbol)
+    : control_node(name, symbol) {
+    tag = node_kind::jump;
+}
 
 void jump_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
-    control_node::dump(os, prefix, is_last, full);
+    control_node::dump(os, lines, prefix, is_last, full);
 }
 
 unary_node::unary_node(
@@ -339,20 +878,24 @@ unary_node::unary_node(
     , expr(std::move(expr))
     , is_prefix(is_prefix)
     , priority(priority) {
+    tag = node_kind::unary;
     fixed_size += this->expr->fixed_size;
     full_size += this->expr->full_size;
+    fixed_bytes += this->expr->fixed_bytes;
+    full_bytes += this->expr->full_bytes;
 }
 
-const position& unary_node::get_start() const { return op.pos; }
+std::streamoff unary_node::get_start() const { return op.offset; }
 
 void unary_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "Unary(" << op.word
        << (is_prefix ? ", prefix" : ", postfix") << ", prio=" << priority
        << ")\n";
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-    expr->dump(os, child_prefix, true, full);
+    expr->dump(os, lines, child_prefix, true, full);
 }
 
 binary_node::binary_node(
@@ -362,20 +905,24 @@ binary_node::binary_node(
     , lhs(std::move(lhs))
     , rhs(std::move(rhs))
     , priority(priority) {
+    tag = node_kind::binary;
     fixed_size += this->lhs->fixed_size + this->rhs->fixed_size;
     full_size += this->lhs->full_size + this->rhs->full_size;
+    fixed_bytes += this->lhs->fixed_bytes + this->rhs->fixed_bytes;
+    full_bytes += this->lhs->full_bytes + this->rhs->full_bytes;
 }
 
-const position& binary_node::get_start() const { return op.pos; }
+std::streamoff binary_node::get_start() const { return op.offset; }
 
 void binary_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "Binary(" << op.word
        << ", prio=" << priority << ")\n";
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-    lhs->dump(os, child_prefix, false, full);
-    rhs->dump(os, child_prefix, true, full);
+    lhs->dump(os, lines, child_prefix, false, full);
+    rhs->dump(os, lines, child_prefix, true, full);
 }
 
 ternary_node::ternary_node(
@@ -388,21 +935,45 @@ ternary_node::ternary_node(
     , left(std::move(left))
     , right(std::move(right))
     , priority(priority) {
+    tag = node_kind::ternary;
     fixed_size += this->cond->fixed_size + this->left->fixed_size
         + this->right->fixed_size;
     full_size += this->cond->full_size + this->left->full_size
         + this->right->full_size;
+    fixed_bytes += this->cond->fixed_bytes + this->left->fixed_bytes
+        + this->right->fixed_bytes;
+    full_bytes += this->cond->full_bytes + this->left->full_bytes
+        + this->right->full_bytes;
 }
 
-const position& ternary_node::get_start() const { return qmark.pos; }
+std::streamoff ternary_node::get_start() const { return qmark.offset; }
 
 void ternary_node::dump(
-    std::ostream& os, const std::string& prefix, bool is_last, bool full
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    bool is_last, bool full
 ) const {
     os << prefix << (is_last ? "`-" : "|-") << "Ternary(?:) prio=" << priority
        << "\n";
     const std::string child_prefix = prefix + (is_last ? "  " : "| ");
-    cond->dump(os, child_prefix, false, full);
-    left->dump(os, child_prefix, false, full);
-    right->dump(os, child_prefix, true, full);
+    cond->dump(os, lines, child_prefix, false, full);
+    left->dump(os, lines, child_prefix, false, full);
+    right->dump(os, lines, child_prefix, true, full);
+}
+
+const std::streamoff* first_offset(const ast_node& node) noexcept {
+    const ast_node* found = leftmost_node(node);
+    if (found == nullptr) {
+        return nullptr;
+    }
+    using result = const std::streamoff*;
+    return visit_node(*found, []<typename N>(const N& n) -> result {
+        if constexpr (std::is_base_of_v<token_node, N>) {
+            return &n.value.offset;
+        } else if constexpr (std::is_base_of_v<wrapped_node, N>) {
+            return &n.start;
+        } else if constexpr (std::is_same_v<unary_node, N>) {
+            return &n.op.offset;
+        }
+        return nullptr;
+    });
 }
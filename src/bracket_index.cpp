@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "bracket_index.hpp"
+
+#include "scanner.hpp"
+
+#include <algorithm>
+
+static constexpr size_t unmatched = std::string_view::npos;
+
+static char opening_of(const char close) noexcept {
+    switch (close) {
+    case ')':
+        return '(';
+    case ']':
+        return '[';
+    default:
+        return '{';
+    }
+}
+
+/// Offset just past the string literal whose quote is at @p at.
+static size_t string_end(const std::string_view text, const size_t at) {
+    const char quote[] = { text[at], '\\', '\0' };
+    size_t i = text.find_first_of(quote, at + 1);
+    while (i != text.npos && text[i] == '\\') {
+        i = text.find_first_of(quote, i + 2);
+    }
+    return i == text.npos ? text.size() : i + 1;
+}
+
+/// Offset just past the comment whose leading '/' is at @p at.
+static size_t comment_end(const std::string_view text, const size_t at) {
+    if (text[at + 1] == '/') {
+        const size_t end = text.find('\n', at + 2);
+        return end == text.npos ? text.size() : end + 1;
+    }
+    const size_t end = text.find("*/", at + 2);
+    return end == text.npos ? text.size() : end + 2;
+}
+
+bracket_index::bracket_index(const std::string_view text) {
+    std::vector<size_t> candidates;
+    scanner::structural(text, candidates);
+    // entries of @c matched whose closing bracket is not seen yet
+    std::vector<size_t> open;
+    size_t skip_to = 0;
+    for (const size_t at : candidates) {
+        if (at < skip_to) {
+            continue;
+        }
+        switch (const char c = text[at]) {
+        case '(':
+        case '[':
+        case '{':
+            open.push_back(matched.size());
+            matched.push_back({ at, unmatched });
+            break;
+        case ')':
+        case ']':
+        case '}':
+            if (open.empty()
+                || text[matched[open.back()].open] != opening_of(c)) {
+                first_unbalanced = at;
+            } else {
+                matched[open.back()].close = at;
+                open.pop_back();
+            }
+            break;
+        case '/':
+            if (at + 1 < text.size()
+                && (text[at + 1] == '/' || text[at + 1] == '*')) {
+                skip_to = comment_end(text, at);
+            }
+            break;
+        default:
+            skip_to = string_end(text, at);
+        }
+        if (first_unbalanced) {
+            break;
+        }
+    }
+    if (!first_unbalanced && !open.empty()) {
+        first_unbalanced = matched[open.back()].open;
+    }
+    std::erase_if(matched, [](const bracket_pair& pair) {
+        return pair.close == unmatched;
+    });
+}
+
+const std::vector<bracket_pair>& bracket_index::pairs() const noexcept {
+    return matched;
+}
+
+std::optional<size_t> bracket_index::close_of(const size_t open) const {
+    const auto it = std::lower_bound(
+        matched.begin(), matched.end(), open,
+        [](const bracket_pair& pair, const size_t offset) {
+            return pair.open < offset;
+        }
+    );
+    if (it == matched.end() || it->open != open) {
+        return std::nullopt;
+    }
+    return it->close;
+}
+
+bool bracket_index::balanced() const noexcept { return !first_unbalanced; }
+
+std::optional<size_t> bracket_index::unbalanced() const noexcept {
+    return first_unbalanced;
+}
@@ -25,162 +25,187 @@
 #include "expression.hpp"
 
 #include <array>
-#include <string_view>
-#include <unordered_map>
 
-const std::unordered_map<std::string, std::pair<int, bool>>
-    expression::binary_ops = { { "=", { 1, true } },    { "+=", { 1, true } },
-                               { "-=", { 1, true } },   { "*=", { 1, true } },
-                               { "/=", { 1, true } },   { "%=", { 1, true } },
-                               { "^=", { 1, true } },   { "|=", { 1, true } },
-                               { "&=", { 1, true } },   { "<<=", { 1, true } },
-                               { ">>=", { 1, true } },  { "||", { 3, false } },
-                               { "&&", { 4, false } },  { "|", { 5, false } },
-                               { "^", { 6, false } },   { "&", { 7, false } },
-                               { "==", { 8, false } },  { "!=", { 8, false } },
-                               { "<", { 9, false } },   { "<=", { 9, false } },
-                               { ">", { 9, false } },   { ">=", { 9, false } },
-                               { "<<", { 10, false } }, { ">>", { 10, false } },
-                               { "+", { 11, false } },  { "-", { 11, false } },
-                               { "*", { 12, false } },  { "/", { 12, false } },
-                               { "%", { 12, false } } };
+/// Precedences of an operator in each position, 0 where it cannot appear.
+struct binding {
+    int binary { 0 };
+    bool right { false };
+    int prefix { 0 };
+    int postfix { 0 };
+};
 
-const std::unordered_map<std::string, int> expression::prefix_ops
-    = { { "+", 13 }, { "-", 13 },  { "!", 13 },
-        { "~", 13 }, { "++", 13 }, { "--", 13 } };
-
-const std::unordered_map<std::string, int> expression::postfix_ops
-    = { { "++", 14 }, { "--", 14 } };
-
-token expression::make_token(const token_node& tn, std::string_view word) {
-    token t = tn.value;
-    t.word = word;
-    return t;
+static constexpr size_t index_of(const op_kind op) noexcept {
+    return static_cast<size_t>(op);
 }
 
-bool expression::match_op(
-    const std::vector<ast_node_ptr>& nodes, size_t pos, std::string_view op
-) {
-    if (pos + op.size() > nodes.size()) {
-        return false;
+// indexed by the op_kind the reader assigns, op_kind::colon being the last
+static constexpr auto bindings = [] {
+    std::array<binding, index_of(op_kind::colon) + 1> table {};
+    for (const auto op :
+         { op_kind::assign, op_kind::add_assign, op_kind::sub_assign,
+           op_kind::mul_assign, op_kind::div_assign, op_kind::mod_assign,
+           op_kind::xor_assign, op_kind::or_assign, op_kind::and_assign,
+           op_kind::shl_assign, op_kind::shr_assign }) {
+        table[index_of(op)] = { 1, true, 0, 0 };
     }
-    size_t i = 0;
-    for (char c : op) {
-        const auto tn = std::dynamic_pointer_cast<token_node>(nodes[pos + i]);
-        if (!tn || tn->value.word != std::string(1, c)) {
-            return false;
-        }
-        ++i;
+    table[index_of(op_kind::question)] = { 2, true, 0, 0 };
+    table[index_of(op_kind::logical_or)].binary = 3;
+    table[index_of(op_kind::logical_and)].binary = 4;
+    table[index_of(op_kind::bit_or)].binary = 5;
+    table[index_of(op_kind::bit_xor)].binary = 6;
+    table[index_of(op_kind::bit_and)].binary = 7;
+    for (const auto op : { op_kind::equal, op_kind::not_equal }) {
+        table[index_of(op)].binary = 8;
     }
-    return true;
-}
+    for (const auto op :
+         { op_kind::less, op_kind::less_equal, op_kind::greater,
+           op_kind::greater_equal }) {
+        table[index_of(op)].binary = 9;
+    }
+    for (const auto op : { op_kind::shl, op_kind::shr }) {
+        table[index_of(op)].binary = 10;
+    }
+    for (const auto op : { op_kind::plus, op_kind::minus }) {
+        table[index_of(op)] = { 11, false, 13, 0 };
+    }
+    for (const auto op : { op_kind::star, op_kind::slash, op_kind::percent }) {
+        table[index_of(op)].binary = 12;
+    }
+    for (const auto op : { op_kind::logical_not, op_kind::bit_not }) {
+        table[index_of(op)].prefix = 13;
+    }
+    for (const auto op : { op_kind::increment, op_kind::decrement }) {
+        table[index_of(op)] = { 0, false, 13, 14 };
+    }
+    return table;
+}();
 
-std::vector<expression::item>
-expression::make_items(const std::vector<ast_node_ptr>& nodes) {
-    std::vector<item> res;
-    for (size_t i = 0; i < nodes.size();) {
-        if (auto tn = std::dynamic_pointer_cast<token_node>(nodes[i])) {
-            if (tn->value.kind == token_kind::special_character
-                || tn->value.kind == token_kind::separator) {
-                static constexpr std::array<std::string_view, 20> multi_ops {
-                    "<<=", ">>=", "++", "--", "+=", "-=", "*=",
-                    "/=",  "%=",  "^=", "|=", "&=", "==", "!=",
-                    "<=",  ">=",  "<<", ">>", "&&", "||"
-                };
+static constexpr const binding& binding_of(const op_kind op) noexcept {
+    return bindings[index_of(op)];
+}
 
-                std::string_view op = tn->value.word;
-                size_t len = 1;
-                for (auto candidate : multi_ops) {
-                    if (match_op(nodes, i, candidate)) {
-                        op = candidate;
-                        len = candidate.size();
-                        break;
-                    }
-                }
+static_assert(binding_of(op_kind::none).binary == 0);
+static_assert(binding_of(op_kind::colon).binary == 0);
 
-                token tok = make_token(*tn, op);
-                res.push_back({ true, tok, {} });
-                i += len;
-                continue;
-            }
+const token* expression::operator_of(const ast_node_ptr& node) noexcept {
+    if (const auto tn = node_cast<token_node>(node)) {
+        if (tn->value.kind == token_kind::special_character
+            || tn->value.kind == token_kind::separator) {
+            return &tn->value;
         }
-        res.push_back({ false, {}, nodes[i] });
-        ++i;
     }
-    return res;
+    return nullptr;
 }
 
 ast_node_ptr expression::parse_expression(
-    std::vector<item>& items, size_t& idx, const int min_prec
+    const std::span<const ast_node_ptr> nodes, size_t& idx, const int min_prec,
+    ast_arena& arena, scratch& work
 ) {
-    auto left = parse_prefix(items, idx);
-    while (idx < items.size()) {
-        if (!items[idx].is_op) {
-            break;
-        }
-        auto op = items[idx].tok.word;
-        if (op == "?") {
-            int prec = 2;
-            if (prec < min_prec) {
+    auto& stack = work.stack;
+    stack.clear();
+    int level = min_prec;
+    while (true) {
+        auto left = parse_prefix(nodes, idx, arena, work);
+        bool descend = false;
+        while (!descend) {
+            const token* op = nullptr;
+            while (idx < nodes.size() && (op = operator_of(nodes[idx]))) {
+                const int prec = binding_of(op->op).binary;
+                if (prec == 0 || prec < level) {
+                    break;
+                }
+                if (op->op == op_kind::question) {
+                    stack.push_back(
+                        { pending::step::middle, level, left, op, prec, {},
+                          nullptr }
+                    );
+                    ++idx;
+                    level = 0;
+                    descend = true;
+                    break;
+                }
+                stack.push_back(
+                    { pending::step::binary, level, left, op, prec, {},
+                      nullptr }
+                );
+                ++idx;
+                level = prec + (binding_of(op->op).right ? 0 : 1);
+                descend = true;
                 break;
             }
-            token qtok = items[idx].tok;
-            ++idx;
-            auto middle = parse_expression(items, idx, 0);
-            if (idx >= items.size() || !items[idx].is_op
-                || items[idx].tok.word != ":") {
-                throw std::runtime_error("expected ':' in ternary expression");
+            if (descend) {
+                break;
+            }
+            if (stack.empty()) {
+                return left;
+            }
+            auto top = stack.back();
+            stack.pop_back();
+            level = top.min_prec;
+            switch (top.stage) {
+            case pending::step::binary:
+                left = arena.make<binary_node>(
+                    *top.op, top.left, left, top.prec
+                );
+                break;
+            case pending::step::middle:
+                op = idx < nodes.size() ? operator_of(nodes[idx]) : nullptr;
+                if (op == nullptr || op->op != op_kind::colon) {
+                    throw std::runtime_error(
+                        "expected ':' in ternary expression"
+                    );
+                }
+                top.stage = pending::step::right;
+                top.middle = left;
+                top.colon = op;
+                ++idx;
+                level = top.prec;
+                stack.push_back(top);
+                descend = true;
+                break;
+            case pending::step::right:
+                left = arena.make<ternary_node>(
+                    *top.op, *top.colon, top.left, top.middle, left, top.prec
+                );
+                break;
             }
-            token ctok = items[idx].tok;
-            ++idx;
-            auto right = parse_expression(items, idx, prec);
-            left = std::make_shared<ternary_node>(
-                qtok, ctok, left, middle, right, prec
-            );
-            continue;
-        }
-        auto it = binary_ops.find(op);
-        if (it == binary_ops.end()) {
-            break;
-        }
-        int prec = it->second.first;
-        const bool right = it->second.second;
-        if (prec < min_prec) {
-            break;
         }
-        token optok = items[idx].tok;
-        ++idx;
-        auto rhs = parse_expression(items, idx, prec + (right ? 0 : 1));
-        left = std::make_shared<binary_node>(optok, left, rhs, prec);
     }
-    return left;
 }
 
-ast_node_ptr expression::parse_prefix(std::vector<item>& items, size_t& idx) {
-    if (idx < items.size() && items[idx].is_op) {
-        if (const auto it = prefix_ops.find(items[idx].tok.word);
-            it != prefix_ops.end()) {
-            token tok = items[idx].tok;
-            int prec = it->second;
-            ++idx;
-            auto operand = parse_prefix(items, idx);
-            return std::make_shared<unary_node>(tok, operand, true, prec);
+ast_node_ptr expression::parse_prefix(
+    const std::span<const ast_node_ptr> nodes, size_t& idx, ast_arena& arena,
+    scratch& work
+) {
+    auto& prefixes = work.prefixes;
+    prefixes.clear();
+    const token* op = nullptr;
+    while (idx < nodes.size() && (op = operator_of(nodes[idx]))) {
+        if (binding_of(op->op).prefix == 0) {
+            break;
         }
+        prefixes.push_back(op);
+        ++idx;
     }
-    if (idx >= items.size()) {
+    if (idx >= nodes.size()) {
         throw std::runtime_error("unexpected end");
     }
-    auto node = items[idx].node;
+    if (operator_of(nodes[idx]) != nullptr) {
+        throw std::runtime_error("expected operand");
+    }
+    auto node = nodes[idx];
     ++idx;
-    while (idx < items.size() && items[idx].is_op) {
-        auto it = postfix_ops.find(items[idx].tok.word);
-        if (it == postfix_ops.end()) {
+    while (idx < nodes.size() && (op = operator_of(nodes[idx]))) {
+        const int prec = binding_of(op->op).postfix;
+        if (prec == 0) {
             break;
         }
-        token tok = items[idx].tok;
-        int prec = it->second;
         ++idx;
-        node = std::make_shared<unary_node>(tok, node, false, prec);
+        node = arena.make<unary_node>(*op, node, false, prec);
+    }
+    for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
+        const int prec = binding_of((*it)->op).prefix;
+        node = arena.make<unary_node>(**it, node, true, prec);
     }
     return node;
 }
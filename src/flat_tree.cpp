@@ -0,0 +1,629 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "flat_tree.hpp"
+#include "interner.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+flat_tree::flat_tree(const ast_node& root) {
+    // pre-order walk; last_child links each new node behind its siblings
+    std::vector<uint32_t> last_child;
+    std::vector<std::pair<const ast_node*, uint32_t>> pending {
+        { &root, none }
+    };
+    std::vector<const ast_node*> children;
+    while (!pending.empty()) {
+        const auto [node, parent] = pending.back();
+        pending.pop_back();
+        const uint32_t index = add(*node);
+        last_child.push_back(none);
+        if (parent != none) {
+            if (last_child[parent] == none) {
+                first_children[parent] = index;
+            } else {
+                next_siblings[last_child[parent]] = index;
+            }
+            last_child[parent] = index;
+        }
+        children.clear();
+        for_each_child(*node, [&children](const ast_node& child) {
+            children.push_back(&child);
+        });
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            pending.emplace_back(*it, index);
+        }
+    }
+}
+
+uint32_t flat_tree::add(const ast_node& node) {
+    if (kinds.size() >= none) {
+        throw std::runtime_error("[FlatTree-Error] too many nodes");
+    }
+    const auto index = static_cast<uint32_t>(kinds.size());
+    group_kind group = group_kind::halt;
+    uint8_t bits = 0;
+    int priority = 0;
+    auto first_token = static_cast<uint32_t>(tokens.size());
+    visit_node(node, [&]<typename N>(const N& n) {
+        if constexpr (std::is_base_of_v<group_node, N>) {
+            group = n.kind;
+            if constexpr (std::is_base_of_v<wrapped_node, N>) {
+                regions.push_back({ index, n.start, n.end, n.full_bytes });
+            }
+            if constexpr (std::is_same_v<placeholder_node, N>) {
+                bits |= n.parsed ? 0 : is_skipped;
+            }
+        } else if constexpr (std::is_base_of_v<token_node, N>) {
+            tokens.push_back(n.value);
+            symbols.push_back(n.symbol);
+            if constexpr (std::is_base_of_v<callexp_node, N>) {
+                bits |= n.has_paren ? has_paren : 0;
+            }
+            if constexpr (std::is_same_v<condition_node, N>) {
+                bits |= n.has_paren ? has_paren : 0;
+                bits |= n.is_loop ? is_loop : 0;
+            }
+            if constexpr (std::is_base_of_v<control_node, N>
+                          || std::is_same_v<fundecl_node, N>) {
+                bits |= n.has_body ? has_body : 0;
+            }
+        } else if constexpr (std::is_same_v<unary_node, N>) {
+            tokens.push_back(n.op);
+            symbols.push_back(0);
+            bits |= n.is_prefix ? is_prefix : 0;
+            priority = n.priority;
+        } else if constexpr (std::is_same_v<binary_node, N>) {
+            tokens.push_back(n.op);
+            symbols.push_back(0);
+            priority = n.priority;
+        } else if constexpr (std::is_same_v<ternary_node, N>) {
+            tokens.push_back(n.qmark);
+            tokens.push_back(n.colon);
+            symbols.resize(tokens.size(), 0);
+            priority = n.priority;
+        }
+    });
+    if (first_token == tokens.size()) {
+        first_token = none;
+    }
+    kinds.push_back(node.tag);
+    groups.push_back(group);
+    flags.push_back(bits);
+    priorities.push_back(static_cast<uint8_t>(priority));
+    first_children.push_back(none);
+    next_siblings.push_back(none);
+    token_index.push_back(first_token);
+    fixed_sizes.push_back(static_cast<uint32_t>(node.fixed_size));
+    full_sizes.push_back(static_cast<uint32_t>(node.full_size));
+    return index;
+}
+
+size_t flat_tree::size() const noexcept { return kinds.size(); }
+
+node_kind flat_tree::kind(const uint32_t node) const noexcept {
+    return kinds[node];
+}
+
+group_kind flat_tree::group(const uint32_t node) const noexcept {
+    return groups[node];
+}
+
+uint32_t flat_tree::first_child(const uint32_t node) const noexcept {
+    return first_children[node];
+}
+
+uint32_t flat_tree::next_sibling(const uint32_t node) const noexcept {
+    return next_siblings[node];
+}
+
+const token* flat_tree::value(const uint32_t node) const noexcept {
+    return token_index[node] == none ? nullptr : &tokens[token_index[node]];
+}
+
+uint32_t flat_tree::symbol(const uint32_t node) const noexcept {
+    return token_index[node] == none ? 0 : symbols[token_index[node]];
+}
+
+size_t flat_tree::fixed_size(const uint32_t node) const noexcept {
+    return fixed_sizes[node];
+}
+
+size_t flat_tree::full_size(const uint32_t node) const noexcept {
+    return full_sizes[node];
+}
+
+const std::streamoff* flat_tree::start(const uint32_t node) const noexcept {
+    const region* r = find_region(node);
+    return r != nullptr ? &r->start : nullptr;
+}
+
+const flat_tree::region*
+flat_tree::find_region(const uint32_t node) const noexcept {
+    const auto it = std::lower_bound(
+        regions.begin(), regions.end(), node,
+        [](const region& entry, const uint32_t n) { return entry.node < n; }
+    );
+    return it != regions.end() && it->node == node ? &*it : nullptr;
+}
+
+void flat_tree::dump(
+    std::ostream& os, const line_index& lines, const bool full
+) const {
+    if (kinds.empty()) {
+        return;
+    }
+    // one prefix buffer is enough: a pending node's prefix is only ever
+    // overwritten past its own length by the subtrees printed before it
+    std::string prefix;
+    std::vector<std::pair<uint32_t, size_t>> pending { { 0, 0 } };
+    while (!pending.empty()) {
+        const auto [node, depth] = pending.back();
+        pending.pop_back();
+        prefix.resize(depth);
+        const bool is_last = next_siblings[node] == none;
+        const bool has_children = first_children[node] != none;
+        if (!is_last) {
+            pending.emplace_back(next_siblings[node], depth);
+        }
+        const char* marker = is_last ? "`-" : "|-";
+        const char* indent = is_last ? "  " : "| ";
+        const auto counters = [&] {
+            if (!full) {
+                os << " <" << fixed_sizes[node] << "/" << full_sizes[node]
+                   << " nodes>";
+            }
+        };
+        const token* tok = value(node);
+        size_t child_depth = depth + 2;
+        switch (kinds[node]) {
+        case node_kind::node:
+            os << prefix << marker << "Null\n";
+            break;
+        case node_kind::token:
+            tok->dump(os, lines, prefix, true);
+            break;
+        case node_kind::callexp:
+        case node_kind::fundecl:
+            os << prefix << marker
+               << (kinds[node] == node_kind::callexp ? "CallExpr\n"
+                                                     : "FunctionDecl\n");
+            tok->dump(os, lines, prefix + indent, !has_children);
+            break;
+        case node_kind::control:
+        case node_kind::jump:
+            os << prefix << marker << "Control(" << tok->word << ")";
+            counters();
+            os << '\n';
+            break;
+        case node_kind::condition:
+            os << prefix << marker
+               << ((flags[node] & is_loop) != 0 ? "Loop" : "Condition") << '('
+               << tok->word << ")";
+            counters();
+            os << '\n';
+            break;
+        case node_kind::group:
+        case node_kind::wrapped:
+            if (groups[node] != group_kind::file) {
+                os << prefix << marker;
+            } else {
+                child_depth = depth;
+            }
+            os << "Group(" << group_kind_name(groups[node]) << ")";
+            counters();
+            os << "\n";
+            break;
+        case node_kind::placeholder:
+            os << prefix << marker << "Placeholder("
+               << group_kind_name(groups[node]) << ") [";
+            if ((flags[node] & is_skipped) == 0) {
+                os << full_sizes[node] << " nested nodes]\n";
+            } else {
+                os << "not parsed]\n";
+            }
+            break;
+        case node_kind::unary:
+            os << prefix << marker << "Unary(" << tok->word
+               << ((flags[node] & is_prefix) != 0 ? ", prefix" : ", postfix")
+               << ", prio=" << int { priorities[node] } << ")\n";
+            break;
+        case node_kind::binary:
+            os << prefix << marker << "Binary(" << tok->word
+               << ", prio=" << int { priorities[node] } << ")\n";
+            break;
+        case node_kind::ternary:
+            os << prefix << marker << "Ternary(?:) prio="
+               << int { priorities[node] } << "\n";
+            break;
+        }
+        if (has_children) {
+            if (child_depth != depth) {
+                prefix += indent;
+            }
+            pending.emplace_back(first_children[node], child_depth);
+        }
+    }
+}
+
+static constexpr char flat_tree_magic[4] = { 'Q', 'P', 'F', 'T' };
+static constexpr uint32_t flat_tree_version = 4;
+
+template <typename T> static void write_raw(std::ostream& os, const T& value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+template <typename T> static void read_raw(std::istream& is, T& value) {
+    is.read(reinterpret_cast<char*>(&value), sizeof value);
+}
+
+template <typename T>
+static void write_array(std::ostream& os, const std::vector<T>& values) {
+    os.write(
+        reinterpret_cast<const char*>(values.data()),
+        static_cast<std::streamsize>(values.size() * sizeof(T))
+    );
+}
+
+template <typename T>
+static void read_array(std::istream& is, std::vector<T>& values, size_t n) {
+    values.resize(n);
+    is.read(
+        reinterpret_cast<char*>(values.data()),
+        static_cast<std::streamsize>(n * sizeof(T))
+    );
+}
+
+/// Bytes left in @p is, or SIZE_MAX if it cannot tell.
+static size_t remaining(std::istream& is) {
+    const auto here = is.tellg();
+    if (here < 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+    is.seekg(0, std::ios::end);
+    const auto end = is.tellg();
+    is.seekg(here);
+    return end < here ? 0 : static_cast<size_t>(end - here);
+}
+
+static bool is_group(const node_kind kind) noexcept {
+    return group_node::first_kind <= kind && kind <= group_node::last_kind;
+}
+
+void flat_tree::serialize(std::ostream& os) const {
+    os.write(flat_tree_magic, sizeof flat_tree_magic);
+    write_raw(os, flat_tree_version);
+    write_raw(os, static_cast<uint64_t>(kinds.size()));
+    write_array(os, kinds);
+    write_array(os, groups);
+    write_array(os, flags);
+    write_array(os, priorities);
+    write_array(os, first_children);
+    write_array(os, next_siblings);
+    write_array(os, token_index);
+    write_array(os, fixed_sizes);
+    write_array(os, full_sizes);
+    write_raw(os, static_cast<uint64_t>(tokens.size()));
+    for (const auto& t : tokens) {
+        write_raw(os, t.kind);
+        write_raw(os, t.op);
+        write_raw(os, t.offset);
+        write_raw(os, static_cast<uint64_t>(t.word.size()));
+        os.write(t.word.data(), static_cast<std::streamsize>(t.word.size()));
+    }
+    write_raw(os, static_cast<uint64_t>(regions.size()));
+    for (const auto& r : regions) {
+        write_raw(os, r.node);
+        write_raw(os, r.start);
+        write_raw(os, r.end);
+        write_raw(os, r.full_bytes);
+    }
+}
+
+flat_tree
+flat_tree::deserialize(std::istream& is, interner& symbols) {
+    const auto fail = [] {
+        return std::runtime_error("[FlatTree-Error] malformed flat tree");
+    };
+    char magic[sizeof flat_tree_magic] {};
+    uint32_t version = 0;
+    uint64_t count = 0;
+    is.read(magic, sizeof magic);
+    read_raw(is, version);
+    read_raw(is, count);
+    if (!is || std::string_view { magic, sizeof magic }
+            != std::string_view { flat_tree_magic, sizeof flat_tree_magic }
+        || version != flat_tree_version || count >= none) {
+        throw fail();
+    }
+    // counts are checked against the bytes left before anything is sized
+    size_t left = remaining(is);
+    const auto take = [&left, &fail](const uint64_t items, const size_t size) {
+        if (items > left / size) {
+            throw fail();
+        }
+        left -= static_cast<size_t>(items) * size;
+    };
+    constexpr size_t node_bytes = sizeof(node_kind) + sizeof(group_kind)
+        + 2 * sizeof(uint8_t) + 5 * sizeof(uint32_t);
+    constexpr size_t token_bytes = sizeof(token_kind) + sizeof(op_kind)
+        + sizeof(std::streamoff) + sizeof(uint64_t);
+    constexpr size_t region_bytes
+        = sizeof(uint32_t) + 2 * sizeof(std::streamoff) + sizeof(uint64_t);
+    take(count, node_bytes);
+    flat_tree tree;
+    const auto n = static_cast<size_t>(count);
+    read_array(is, tree.kinds, n);
+    read_array(is, tree.groups, n);
+    read_array(is, tree.flags, n);
+    read_array(is, tree.priorities, n);
+    read_array(is, tree.first_children, n);
+    read_array(is, tree.next_siblings, n);
+    read_array(is, tree.token_index, n);
+    read_array(is, tree.fixed_sizes, n);
+    read_array(is, tree.full_sizes, n);
+    read_raw(is, count);
+    if (!is || count >= none) {
+        throw fail();
+    }
+    take(sizeof count, 1);
+    take(count, token_bytes);
+    tree.tokens.resize(static_cast<size_t>(count));
+    std::vector<std::pair<size_t, size_t>> words;
+    auto pool = std::make_shared<std::string>();
+    for (auto& t : tree.tokens) {
+        uint64_t length = 0;
+        read_raw(is, t.kind);
+        read_raw(is, t.op);
+        read_raw(is, t.offset);
+        read_raw(is, length);
+        if (!is || t.kind > token_kind::error || t.op > op_kind::colon
+            || length > std::numeric_limits<uint32_t>::max()) {
+            throw fail();
+        }
+        take(length, 1);
+        words.emplace_back(pool->size(), static_cast<size_t>(length));
+        pool->resize(pool->size() + words.back().second);
+        is.read(
+            pool->data() + words.back().first,
+            static_cast<std::streamsize>(words.back().second)
+        );
+    }
+    read_raw(is, count);
+    if (!is || count > n) {
+        throw fail();
+    }
+    take(sizeof count, 1);
+    take(count, region_bytes);
+    tree.regions.resize(static_cast<size_t>(count));
+    for (auto& r : tree.regions) {
+        read_raw(is, r.node);
+        read_raw(is, r.start);
+        read_raw(is, r.end);
+        read_raw(is, r.full_bytes);
+    }
+    if (!is) {
+        throw fail();
+    }
+    for (size_t i = 0; i < tree.regions.size(); ++i) {
+        const uint32_t node = tree.regions[i].node;
+        if (node >= n || (i > 0 && node <= tree.regions[i - 1].node)) {
+            throw fail();
+        }
+    }
+    // views are taken once the pool no longer grows
+    tree.symbols.resize(tree.tokens.size(), 0);
+    for (size_t i = 0; i < tree.tokens.size(); ++i) {
+        auto& t = tree.tokens[i];
+        t.word = std::string_view { *pool }.substr(
+            words[i].first, words[i].second
+        );
+        if (t.kind == token_kind::keyword) {
+            tree.symbols[i] = symbols.intern(t.word);
+        }
+    }
+    tree.pool = std::move(pool);
+    for (size_t i = 0; i < n; ++i) {
+        const node_kind kind = tree.kinds[i];
+        if (kind > node_kind::ternary || tree.groups[i] > group_kind::halt) {
+            throw fail();
+        }
+        // named nodes and operators print and rebuild from their tokens
+        const size_t needed = kind == node_kind::ternary ? 2
+            : kind != node_kind::node && !is_group(kind) ? 1
+                                                         : 0;
+        const uint32_t first = tree.token_index[i];
+        if (needed != 0
+            && (first == none || first + needed > tree.tokens.size())) {
+            throw fail();
+        }
+        const auto links = { tree.first_children[i], tree.next_siblings[i] };
+        for (const auto link : links) {
+            if (link != none && (link <= i || link >= n)) {
+                throw fail();
+            }
+        }
+        if (tree.token_index[i] != none
+            && tree.token_index[i] + 1u > tree.tokens.size()) {
+            throw fail();
+        }
+    }
+    return tree;
+}
+
+ast_root flat_tree::inflate(const placeholder_node& origin) const {
+    if (kinds.empty() || !is_group(kinds[0])) {
+        throw std::runtime_error("[FlatTree-Error] root is not a group");
+    }
+    // the nodes keep the pool their tokens view alive
+    struct inflated {
+        std::shared_ptr<const std::string> pool;
+        ast_arena arena;
+    };
+    const auto owner = std::make_shared<inflated>();
+    owner->pool = pool;
+    ast_arena& arena = owner->arena;
+    std::vector<ast_node_ptr> built(kinds.size());
+    std::vector<ast_node_ptr> children;
+    const auto fail = [] {
+        return std::runtime_error("[FlatTree-Error] malformed node");
+    };
+    const auto child = [&](const size_t i) {
+        if (i >= children.size()) {
+            throw fail();
+        }
+        return children[i];
+    };
+    // children follow their parent in pre-order, so build back to front
+    for (auto node = static_cast<uint32_t>(kinds.size()); node-- > 0;) {
+        children.clear();
+        for (uint32_t c = first_children[node]; c != none;
+             c = next_siblings[c]) {
+            children.push_back(built[c]);
+        }
+        const token* tok = value(node);
+        const uint32_t id = symbol(node);
+        const bool needs_token = kinds[node] != node_kind::node
+            && !is_group(kinds[node]);
+        if (needs_token
+            && (tok == nullptr
+                || (kinds[node] == node_kind::ternary
+                    && token_index[node] + 2u > tokens.size()))) {
+            throw fail();
+        }
+        const uint8_t bits = flags[node];
+        const int priority = priorities[node];
+        ast_node_ptr result;
+        switch (kinds[node]) {
+        case node_kind::node:
+            result = arena.make<ast_node>();
+            break;
+        case node_kind::token:
+            result = arena.make<token_node>(*tok, id);
+            break;
+        case node_kind::callexp:
+        case node_kind::fundecl: {
+            auto call = arena.make<callexp_node>(*tok, id);
+            if ((bits & has_paren) != 0) {
+                call->set_paren(child(0));
+            }
+            if (kinds[node] == node_kind::fundecl) {
+                const auto decl = arena.make<fundecl_node>(call);
+                if ((bits & has_body) != 0) {
+                    decl->set_body(child((bits & has_paren) != 0 ? 1 : 0));
+                }
+                call = decl;
+            }
+            result = call;
+            break;
+        }
+        case node_kind::control:
+        case node_kind::jump: {
+            const auto ctrl = kinds[node] == node_kind::jump
+                ? node_ptr<control_node>(arena.make<jump_node>(*tok, id))
+                : arena.make<control_node>(*tok, id);
+            if ((bits & has_body) != 0) {
+                ctrl->set_body(child(0));
+            }
+            result = ctrl;
+            break;
+        }
+        case node_kind::condition: {
+            const auto cond = arena.make<condition_node>(*tok, id);
+            cond->is_loop = (bits & is_loop) != 0;
+            if ((bits & has_paren) != 0) {
+                cond->set_paren(child(0));
+            }
+            if ((bits & has_body) != 0) {
+                cond->set_body(child((bits & has_paren) != 0 ? 1 : 0));
+            }
+            result = cond;
+            break;
+        }
+        case node_kind::group:
+        case node_kind::wrapped:
+        case node_kind::placeholder: {
+            group_ptr group;
+            if (kinds[node] == node_kind::group) {
+                group = arena.make<group_node>();
+            } else {
+                const auto wrapped = kinds[node] == node_kind::placeholder
+                    ? node_ptr<wrapped_node>(arena.make<placeholder_node>())
+                    : arena.make<wrapped_node>();
+                if (const region* r = find_region(node)) {
+                    wrapped->start = r->start;
+                    wrapped->end = r->end;
+                    // a placeholder has no children to add them up from
+                    if (kinds[node] == node_kind::placeholder) {
+                        wrapped->full_bytes
+                            = static_cast<size_t>(r->full_bytes);
+                    }
+                }
+                group = wrapped;
+            }
+            group->kind = groups[node];
+            group->limit = origin.limit;
+            group->byte_limit = origin.byte_limit;
+            if (const auto ph = node_cast<placeholder_node>(group)) {
+                ph->src = origin.src;
+                ph->cache = origin.cache;
+                ph->spill = origin.spill;
+                ph->parsed = (bits & is_skipped) == 0;
+                ph->lazy_depth = origin.lazy_depth;
+                ph->diagnostics = origin.diagnostics;
+            }
+            for (const auto& c : children) {
+                group->nodes.push_back(c);
+                group->fixed_bytes += c->fixed_bytes + sizeof(ast_node_ptr);
+                group->full_bytes += c->full_bytes + sizeof(ast_node_ptr);
+            }
+            result = group;
+            break;
+        }
+        case node_kind::unary:
+            result = arena.make<unary_node>(
+                *tok, child(0), (bits & is_prefix) != 0, priority
+            );
+            break;
+        case node_kind::binary:
+            result = arena.make<binary_node>(
+                *tok, child(0), child(1), priority
+            );
+            break;
+        case node_kind::ternary:
+            result = arena.make<ternary_node>(
+                tok[0], tok[1], child(0), child(1), child(2), priority
+            );
+            break;
+        }
+        result->fixed_size = fixed_sizes[node];
+        result->full_size = full_sizes[node];
+        built[node] = result;
+    }
+    return { owner, node_cast<group_node>(built[0]).get() };
+}
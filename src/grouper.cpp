@@ -24,71 +24,941 @@
 
 #include "grouper.hpp"
 
+#include "bracket_index.hpp"
 #include "expression.hpp"
+#include "interner.hpp"
+#include "scanner.hpp"
 
-grouper::grouper(reader& r, const size_t limit)
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+grouper::grouper(
+    reader& r, const size_t limit, subtree_cache* cache, spill_store* spill
+)
     : src(r)
-    , limit(limit) {
+    , limit(limit)
+    , cache(cache)
+    , spill(spill) {
     if (limit < 2) {
         throw make_error("minimum limit is 2");
     }
 }
 
-group_ptr grouper::parse(const group_kind kind) {
+grouper::grouper(
+    reader& r, const memory_budget budget, subtree_cache* cache,
+    spill_store* spill
+)
+    : src(r)
+    , limit(std::numeric_limits<size_t>::max())
+    , byte_limit(budget.bytes)
+    , cache(cache)
+    , spill(spill) {
+    if (byte_limit == 0) {
+        throw make_error("memory budget must not be empty");
+    }
+}
+
+ast_root grouper::parse(const group_kind kind) {
+    const auto owner = std::make_shared<ast_arena>();
+    arena = owner.get();
+    squeezing = { &src, cache, spill, diagnostics, 0 };
+    // the reader recovers from lexical errors during this parse only
+    struct lexical_sink {
+        reader& src;
+        std::vector<diagnostic>* previous;
+        ~lexical_sink() { src.set_diagnostics(previous); }
+    } const restore { src, src.diagnostics() };
+    const size_t reported = diagnostics != nullptr ? diagnostics->size() : 0;
+    if (diagnostics != nullptr) {
+        src.set_diagnostics(diagnostics);
+    }
     group_ptr group, result;
     if (kind == group_kind::body || kind == group_kind::list
         || kind == group_kind::paren) {
-        group = std::make_shared<wrapped_node>();
-        result = std::make_shared<wrapped_node>();
+        group = arena->make<wrapped_node>();
+        result = arena->make<wrapped_node>();
     } else {
-        group = std::make_shared<group_node>();
-        result = std::make_shared<group_node>();
+        group = arena->make<group_node>();
+        result = arena->make<group_node>();
     }
+    // any other root stands in for a placeholder its parent already charged;
+    // squeezing it by bytes again would only yield that placeholder anew
+    const size_t root_bytes = kind == group_kind::file ? byte_limit : 0;
     group->limit = limit;
+    group->byte_limit = root_bytes;
     group->kind = kind;
     result->limit = limit;
+    result->byte_limit = root_bytes;
     result->kind = kind;
+    // a region is held to the budget of the parse that squeezed it, so its
+    // groups squeeze under arena pressure as they did there; eagerly, any
+    // use of the arena is too much
+    squeezing.arena_limit = byte_limit == 0 ? 0 : eager ? 1 : byte_limit;
+    // nodes keep offsets only; errors and dumps find their lines here
+    (void)src.lines();
+    if (lazy_depth == std::numeric_limits<size_t>::max()) {
+        // a region of a squeezed placeholder does not lex the whole file
+        open_stream(kind == group_kind::file);
+    }
+    if (kind == group_kind::file && diagnostics == nullptr) {
+        check_balance();
+    }
     parse_group(kind, group);
+    sync();
+    identify(group, result);
+    // the identified tree took over the children of the grouped one
+    arena->release_node(*group);
+    parse_arithmetic(result);
+    if (diagnostics != nullptr) {
+        // grouping, identification and expressions report in separate passes
+        std::stable_sort(
+            diagnostics->begin() + static_cast<std::ptrdiff_t>(reported),
+            diagnostics->end(),
+            [](const diagnostic& a, const diagnostic& b) {
+                return a.pos.offset < b.pos.offset;
+            }
+        );
+    }
+    parsed_bytes = arena->used();
+    arena = nullptr;
+    if (root_bytes != 0 && parsed_bytes > root_bytes) {
+        throw make_error(
+            "memory budget is too small for the tree (holds "
+                + std::to_string(parsed_bytes) + " bytes, budget is "
+                + std::to_string(root_bytes) + ")"
+        );
+    }
+    return { owner, result.get() };
+}
+
+/**
+ * @brief <tt>{ ... }</tt> spans at the outermost level, as token index pairs.
+ *
+ * The level is that of token @p from; spans past the bracket enclosing it
+ * are left out.
+ */
+static std::vector<std::pair<size_t, size_t>> top_level_bodies(
+    const token_stream& stream, const bracket_index& index, const size_t from
+) {
+    const auto begin = static_cast<size_t>(stream.offset(from));
+    size_t end = std::numeric_limits<size_t>::max();
+    for (const auto& pair : index.pairs()) {
+        if (pair.open >= begin) {
+            break;
+        }
+        if (pair.close >= begin) {
+            end = pair.close;
+        }
+    }
+    std::vector<std::pair<size_t, size_t>> spans;
+    size_t next = begin;
+    for (const auto& [open, close] : index.pairs()) {
+        if (open > end) {
+            break;
+        }
+        if (open < next) {
+            continue;
+        }
+        next = close + 1;
+        const size_t first = stream.find(static_cast<std::streamoff>(open));
+        if (stream.word(first) == "{") {
+            spans.emplace_back(
+                first, stream.find(static_cast<std::streamoff>(close))
+            );
+        }
+    }
+    return spans;
+}
+
+ast_root
+grouper::parse_parallel(const group_kind kind, const unsigned threads) {
+    // a parse that skips every body reads through the reader alone
+    if (lazy_depth == 0) {
+        return parse(kind);
+    }
+    open_stream(true);
+    if (stream == nullptr) {
+        return parse(kind);
+    }
+    if (kind == group_kind::file && diagnostics == nullptr) {
+        check_balance();
+    }
+    // workers report errors through the index, so it is built up front
+    (void)src.lines();
+    prepared.clear();
+    const auto spans = top_level_bodies(*stream, src.brackets(), cursor);
+    for (const auto& [open, close] : spans) {
+        prepared.push_back({ open, close, {}, {}, {} });
+    }
+    int workers = static_cast<int>(threads);
+#ifdef _OPENMP
+    if (workers == 0) {
+        workers = omp_get_max_threads();
+    }
+#endif
+    workers = std::max(workers, 1);
+    const auto count = static_cast<std::ptrdiff_t>(prepared.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(workers)
+#endif
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        grouper worker { src, limit, cache, spill };
+        worker.byte_limit = byte_limit;
+        // the bodies are one level down
+        worker.lazy_depth = lazy_depth;
+        worker.nesting = nesting + 1;
+        worker.stream = stream;
+        worker.detached = true;
+        try {
+            worker.prepare(prepared[static_cast<size_t>(i)]);
+        } catch (const std::exception&) {
+            // parsed again in place, which reports the error in context
+        }
+    }
+    next_prepared = 0;
+    const size_t start = cursor;
+    ast_root root;
+    try {
+        root = parse(kind);
+    } catch (const std::runtime_error&) {
+        // report the error exactly as the sequential parse does
+        prepared.clear();
+        identified.clear();
+        cursor = start;
+        reuse = false;
+        return parse(kind);
+    }
+    prepared.clear();
+    identified.clear();
+    return root;
+}
+
+void grouper::prepare(prepared_body& body) {
+    const auto owner = std::make_shared<ast_arena>();
+    arena = owner.get();
+    squeezing = { &src, cache, spill };
+    cursor = body.open;
+    peek();
+    group_ptr group = append_wrapped({});
+    parse_group(group_kind::body, group);
+    if (cursor != body.close + 1) {
+        return;
+    }
+    const auto result = identify_subgroup(group);
     identify(group, result);
     parse_arithmetic(result);
-    return result;
+    arena = nullptr;
+    body.arena = owner;
+    body.raw = group;
+    body.result = result;
+}
+
+group_ptr grouper::take_prepared() {
+    if (stream == nullptr || prepared.empty()) {
+        return {};
+    }
+    const size_t at = cursor - 1;
+    while (next_prepared < prepared.size()
+           && prepared[next_prepared].open < at) {
+        ++next_prepared;
+    }
+    if (next_prepared == prepared.size() || prepared[next_prepared].open != at
+        || !prepared[next_prepared].arena) {
+        return {};
+    }
+    const auto& body = prepared[next_prepared++];
+    identified.emplace(body.raw.get(), &body);
+    cursor = body.close + 1;
+    return body.raw;
+}
+
+group_ptr grouper::skip_wrapped() {
+    if (!src.is_resident()) {
+        return {};
+    }
+    const auto close = src.brackets().close_of(
+        static_cast<size_t>(current.offset)
+    );
+    if (!close) {
+        return {};
+    }
+    const auto end = static_cast<std::streamoff>(*close);
+    std::streamoff first = 0;
+    if (stream != nullptr) {
+        const size_t last = stream->find(end);
+        if (last <= cursor) {
+            return {};
+        }
+        first = stream->offset(cursor);
+        cursor = last + 1;
+    } else {
+        src.skip_trivia();
+        first = src.get_position().offset;
+        if (first >= end) {
+            return {};
+        }
+        src.jump_to_position({ end + 1, 0, 0 });
+    }
+    const auto ph = arena->make<placeholder_node>();
+    if (current.word == "{") {
+        ph->kind = group_kind::body;
+    } else if (current.word == "[") {
+        ph->kind = group_kind::list;
+    } else {
+        ph->kind = group_kind::paren;
+    }
+    ph->start = first;
+    ph->end = end;
+    ph->src = &src;
+    ph->cache = cache;
+    ph->spill = spill;
+    ph->limit = limit;
+    ph->byte_limit = byte_limit;
+    ph->parsed = false;
+    ph->lazy_depth = lazy_depth;
+    ph->diagnostics = diagnostics;
+    return ph;
+}
+
+void grouper::set_lazy_depth(const size_t depth) noexcept {
+    lazy_depth = depth;
+}
+
+void grouper::set_diagnostics(std::vector<diagnostic>* sink) noexcept {
+    diagnostics = sink;
+}
+
+void grouper::set_eager_squeeze(const bool eager) noexcept {
+    this->eager = eager;
+}
+
+/// Offset of the leftmost token of @p node, -1 if it holds none.
+static std::streamoff leftmost(const ast_node& node) {
+    const auto* at = first_offset(node);
+    return at != nullptr ? *at : -1;
+}
+
+/**
+ * @brief Pass the offsets of the resident tree below @p root to @p move.
+ *
+ * Children come in source order, so only the last child that starts before
+ * @p from is searched further, and the children ahead of it are left out:
+ * none of their offsets is at or after @p from. Children of @p stop are
+ * left out as well. @p retext is called on every token visited that views
+ * the source, @p owner is set as the reader of placeholders unless it is
+ * nullptr.
+ */
+template <typename Move, typename Retext>
+static void move_positions(
+    ast_node& root, const ast_node* stop, const std::streamoff from,
+    const Move& move, const Retext& retext, reader* owner
+) {
+    const auto shift = [&]<typename N>(N& n) {
+        if constexpr (std::is_base_of_v<token_node, N>) {
+            move(n.value.offset);
+            retext(n.value);
+        } else if constexpr (std::is_base_of_v<wrapped_node, N>) {
+            move(n.start);
+            // zero marks an unknown end
+            if (n.end != 0) {
+                move(n.end);
+            }
+            if constexpr (std::is_same_v<placeholder_node, N>) {
+                if (owner != nullptr) {
+                    n.src = owner;
+                }
+            }
+        } else if constexpr (std::is_same_v<ternary_node, N>) {
+            move(n.qmark.offset);
+            retext(n.qmark);
+            // the colon is made up by parse_arithmetic(), its word is no
+            // view into the source
+            move(n.colon.offset);
+        } else if constexpr (std::is_same_v<unary_node, N>
+                             || std::is_same_v<binary_node, N>) {
+            move(n.op.offset);
+            retext(n.op);
+        }
+    };
+    // subtrees moved as a whole, gathered on the way down to @p from
+    std::vector<ast_node*> pending;
+    std::vector<ast_node*> children;
+    for (ast_node* node = &root; node != nullptr;) {
+        visit_node(*node, shift);
+        ast_node* straddling = nullptr;
+        if (node != stop) {
+            children.clear();
+            for_each_child_slot(*node, [&children](ast_node_ptr& child) {
+                children.push_back(child.get());
+            });
+            for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                // a subtree without a known start is moved whole
+                if (const auto at = leftmost(**it); at >= 0 && at < from) {
+                    straddling = *it;
+                    break;
+                }
+                pending.push_back(*it);
+            }
+        }
+        node = straddling;
+    }
+    while (!pending.empty()) {
+        ast_node* node = pending.back();
+        pending.pop_back();
+        visit_node(*node, shift);
+        if (node != stop) {
+            for_each_child_slot(*node, [&pending](ast_node_ptr& child) {
+                pending.push_back(child.get());
+            });
+        }
+    }
+}
+
+/// Whether @p kind is the inside of a bracket.
+static bool is_bracket_kind(const group_kind kind) {
+    return kind == group_kind::body || kind == group_kind::list
+        || kind == group_kind::paren;
+}
+
+std::vector<grouper::damaged_region> grouper::find_damaged(
+    group_node& root, const std::streamoff from, const std::streamoff to,
+    std::vector<ast_node*>& path
+) const {
+    // one frame per resident node on the way down, as in identify()
+    struct frame {
+        ast_node* node;
+        std::vector<ast_node*> children;
+        size_t next;
+        /// offset the node's region ends at, -1 if unknown
+        std::streamoff end;
+    };
+    std::vector<frame> frames;
+    const auto open = [&frames](ast_node* node, const std::streamoff end) {
+        frame f { node, {}, 0, end };
+        for_each_child_slot(*node, [&f](ast_node_ptr& child) {
+            f.children.push_back(child.get());
+        });
+        frames.push_back(std::move(f));
+    };
+    // only the region just found is searched for a narrower one
+    const auto enter = [&frames, &path](ast_node* node) {
+        path.clear();
+        for (auto& f : frames) {
+            path.push_back(f.node);
+            f.next = f.children.size();
+        }
+        path.push_back(node);
+    };
+    std::vector<damaged_region> regions;
+    path.clear();
+    open(&root, static_cast<std::streamoff>(src.source().size()));
+    while (!frames.empty()) {
+        auto& f = frames.back();
+        if (f.next == f.children.size()) {
+            frames.pop_back();
+            continue;
+        }
+        const size_t index = f.next++;
+        ast_node* child = f.children[index];
+        // a group child ends where its next sibling begins
+        std::streamoff end = f.end;
+        if (isa<group_node>(f.node) && index + 1 < f.children.size()) {
+            end = leftmost(*f.children[index + 1]);
+        }
+        const std::streamoff begin = leftmost(*child);
+        if (begin > to || (end >= 0 && end <= from)) {
+            continue;
+        }
+        const size_t depth = frames.size();
+        const auto* wn = isa<wrapped_node>(child)
+            ? static_cast<wrapped_node*>(child)
+            : nullptr;
+        const bool bracket = wn != nullptr && is_bracket_kind(wn->kind)
+            && wn->end > wn->start;
+        if (const auto* ph = isa<placeholder_node>(child)
+                ? static_cast<placeholder_node*>(child)
+                : nullptr) {
+            if (bracket && ph->start <= from && to <= ph->end) {
+                enter(child);
+                regions.push_back(
+                    { child, depth, ph->kind, ph->start, ph->end + 1,
+                      ph->lazy_depth, 0 }
+                );
+            } else if (!bracket && !is_bracket_kind(ph->kind) && end >= 0
+                       && ph->start < from && to <= end) {
+                // strictly after the start, so the edit cannot run into the
+                // token before the region
+                enter(child);
+                regions.push_back(
+                    { child, depth, ph->kind, ph->start, end, ph->lazy_depth,
+                      0 }
+                );
+            }
+            continue;
+        }
+        if (!bracket) {
+            open(child, end);
+            continue;
+        }
+        if (wn->start >= from || wn->end < to) {
+            continue;
+        }
+        size_t level = 1;
+        for (const auto& outer : frames) {
+            if (isa<wrapped_node>(outer.node)) {
+                ++level;
+            }
+        }
+        enter(child);
+        regions.push_back(
+            { child, depth, wn->kind, wn->start + 1, wn->end + 1, lazy_depth,
+              level }
+        );
+        open(child, wn->end);
+    }
+    return regions;
+}
+
+ast_root grouper::parse_damaged(
+    const damaged_region& region, const std::streamoff shift
+) {
+    const auto text = src.source();
+    const auto begin = static_cast<size_t>(region.begin);
+    const auto end = static_cast<size_t>(region.end + shift);
+    if (end < begin || end > text.size()) {
+        return {};
+    }
+    reader part { borrowed_source, text.substr(begin, end - begin) };
+    // a bracket region stops at the first stray closing bracket by itself;
+    // any other one would take it in, where a fresh parse rejects it
+    if (!is_bracket_kind(region.kind) && !part.brackets().balanced()) {
+        return {};
+    }
+    grouper worker = byte_limit != 0
+        ? grouper { part, memory_budget { byte_limit }, cache, spill }
+        : grouper { part, limit, cache, spill };
+    worker.lazy_depth = region.lazy_depth;
+    worker.nesting = region.nesting;
+    ast_root tree;
+    try {
+        tree = worker.parse(region.kind);
+    } catch (const std::runtime_error&) {
+        return {};
+    }
+    const auto stop = part.get_position().offset;
+    if (is_bracket_kind(region.kind)) {
+        // the closing bracket must be the last byte of the region
+        if (stop != static_cast<std::streamoff>(end - begin)) {
+            return {};
+        }
+    } else {
+        // and the separator must be followed by trivia up to the next region,
+        // where the lexer is back in step with the old tree
+        src.jump_to_position({ region.begin + stop, 0, 0 });
+        src.skip_trivia();
+        if (src.get_position().offset != static_cast<std::streamoff>(end)) {
+            return {};
+        }
+    }
+    parsed_bytes = worker.arena_bytes();
+    return tree;
+}
+
+bool grouper::resize_path(
+    const std::vector<ast_node*>& path, const size_t depth,
+    const node_sizes& before, ast_arena& owner
+) const {
+    const squeeze_context context { &src, cache, spill };
+    // deltas wrap around like the counters they are added to
+    const auto* changed = path[depth];
+    size_t fixed = changed->fixed_size - before.fixed_size;
+    size_t full = changed->full_size - before.full_size;
+    size_t fixed_bytes = changed->fixed_bytes - before.fixed_bytes;
+    size_t full_bytes = changed->full_bytes - before.full_bytes;
+    for (size_t i = depth + 1; i-- > 0;) {
+        auto* node = path[i];
+        if (i < depth) {
+            node->fixed_size += fixed;
+            node->full_size += full;
+            node->fixed_bytes += fixed_bytes;
+            node->full_bytes += full_bytes;
+        }
+        if (!isa<group_node>(node) || isa<placeholder_node>(node)) {
+            continue;
+        }
+        auto& group = static_cast<group_node&>(*node);
+        const bool by_bytes = group.byte_limit != 0;
+        while (by_bytes ? group.fixed_bytes > group.byte_limit
+                        : group.fixed_size > group.limit) {
+            // the heaviest resident group goes first, as in append()
+            size_t heaviest = group.nodes.size();
+            size_t weight = by_bytes ? 0 : 1;
+            for (size_t k = 0; k < group.nodes.size(); ++k) {
+                const auto& child = group.nodes[k];
+                if (!isa<group_node>(child) || isa<placeholder_node>(child)
+                    || !squeezable(static_cast<const group_node&>(*child))) {
+                    continue;
+                }
+                const size_t w
+                    = by_bytes ? child->fixed_bytes : child->fixed_size;
+                if (w > weight) {
+                    weight = w;
+                    heaviest = k;
+                }
+            }
+            if (heaviest == group.nodes.size()) {
+                return false;
+            }
+            const size_t size = group.fixed_size;
+            const size_t bytes = group.fixed_bytes;
+            group.squeeze(heaviest, context, owner);
+            fixed += group.fixed_size - size;
+            fixed_bytes += group.fixed_bytes - bytes;
+        }
+    }
+    return true;
+}
+
+ast_root grouper::reparse(const ast_root& previous, const text_edit& edit) {
+    if (!previous || previous->kind != group_kind::file) {
+        throw make_error("only the tree of a whole file can be reparsed");
+    }
+    if (!src.is_resident()) {
+        throw make_error("reparsing requires a resident source");
+    }
+    const auto text = src.source();
+    if (edit.offset > text.size()
+        || edit.removed > text.size() - edit.offset) {
+        throw make_error("edit is out of range");
+    }
+    const auto from = static_cast<std::streamoff>(edit.offset);
+    const auto to = from + static_cast<std::streamoff>(edit.removed);
+    const auto shift = static_cast<std::streamoff>(edit.inserted.size())
+        - static_cast<std::streamoff>(edit.removed);
+    std::vector<ast_node*> path;
+    const auto regions = find_damaged(*previous, from, to, path);
+    // the token stream goes with the old source
+    stream = nullptr;
+    cursor = 0;
+    const char* const before = text.data();
+    src.edit(edit);
+    // unless the source moved, nothing ahead of the edit is to be touched
+    const std::streamoff unmoved = src.source().data() == before ? to : 0;
+    if (cache != nullptr) {
+        cache->clear();
+    }
+    if (spill != nullptr) {
+        spill->clear();
+    }
+    for (auto region = regions.rbegin(); region != regions.rend(); ++region) {
+        const auto tree = parse_damaged(*region, shift);
+        if (!tree) {
+            continue;
+        }
+        move_positions(
+            *previous, region->node, unmoved,
+            [to, shift](std::streamoff& at) {
+                if (at >= to) {
+                    at += shift;
+                }
+            },
+            [this](token& t) { src.relocate(t); }, nullptr
+        );
+        const auto base = region->begin;
+        move_positions(
+            *tree, nullptr, 0,
+            [base](std::streamoff& at) { at += base; },
+            [](token&) { }, &src
+        );
+        ast_node* node = region->node;
+        const node_sizes before { node->fixed_size, node->full_size,
+                                  node->fixed_bytes, node->full_bytes };
+        if (isa<placeholder_node>(node)) {
+            auto& ph = static_cast<placeholder_node&>(*node);
+            // an insertion right at the start is part of the region now
+            ph.start = region->begin;
+            if (ph.parsed) {
+                ph.full_size = tree->full_size;
+                ph.full_bytes = tree->full_bytes;
+            }
+            if (cache != nullptr) {
+                cache->insert(ph.key(), tree, parsed_bytes);
+            }
+        } else {
+            auto& wn = static_cast<wrapped_node&>(*node);
+            wn.nodes = tree->nodes;
+            wn.weights = tree->weights;
+            wn.fixed_size = tree->fixed_size;
+            wn.full_size = tree->full_size;
+            wn.fixed_bytes = tree->fixed_bytes;
+            wn.full_bytes = tree->full_bytes;
+        }
+        const auto owner = std::make_shared<ast_arena>();
+        owner->adopt(previous);
+        owner->adopt(tree);
+        if (!resize_path(path, region->depth, before, *owner)) {
+            break;
+        }
+        return { owner, previous.get() };
+    }
+    src.jump_to_position({ 0, 0, 0 });
+    return parse(group_kind::file);
+}
+
+/// Opening bracket of group kind @p kind.
+static std::string_view opening(const group_kind kind) {
+    switch (kind) {
+    case group_kind::body:
+        return "{";
+    case group_kind::list:
+        return "[";
+    default:
+        return "(";
+    }
+}
+
+/// Group kind of the bracket @p word opens or closes.
+static group_kind bracket_kind(const std::string_view word) {
+    switch (word.front()) {
+    case '{':
+    case '}':
+        return group_kind::body;
+    case '[':
+    case ']':
+        return group_kind::list;
+    default:
+        return group_kind::paren;
+    }
+}
+
+/// Report the keyword @p tok once the token after it is known.
+static void
+emit_keyword(event_handler& handler, const token& tok, const token& next) {
+    // the event parse ids nothing, so its symbol table does not grow
+    const auto kw = reserved_word(tok.word);
+    if (kw >= reserved::kw_if && kw <= reserved::kw_goto) {
+        handler.control(tok);
+    } else if (next.kind == token_kind::open_bracket && next.word == "(") {
+        handler.call(tok);
+    } else {
+        handler.value(tok);
+    }
+}
+
+void grouper::parse(event_handler& handler, const group_kind kind) {
+    // errors are located through the reader, not a token stream
+    stream = nullptr;
+    cursor = 0;
+    // every token is handled before the next is read, so a stream-backed
+    // reader holds a single chunk
+    struct chunk_retention {
+        reader& src;
+        ~chunk_retention() { src.set_retain_chunks(true); }
+    } const restore { src };
+    src.set_retain_chunks(false);
+    std::vector<group_kind> open { kind };
+    src.skip_trivia();
+    handler.enter_group(kind, src.get_position());
+    token keyword;
+    // the keyword waits for the next token, which may reload the chunk
+    std::string keyword_text;
+    bool pending = false;
+    while (true) {
+        src.skip_trivia();
+        const position at = src.get_position();
+        src.next_token(current);
+        if (pending) {
+            emit_keyword(handler, keyword, current);
+            pending = false;
+        }
+        switch (current.kind) {
+        case token_kind::keyword:
+            keyword_text.assign(current.word);
+            keyword = current;
+            keyword.word = keyword_text;
+            pending = true;
+            break;
+        case token_kind::open_bracket:
+            open.push_back(bracket_kind(current.word));
+            handler.enter_group(open.back(), at);
+            break;
+        case token_kind::close_bracket:
+        case token_kind::eof: {
+            const auto closed = current.kind == token_kind::eof
+                ? group_kind::file
+                : bracket_kind(current.word);
+            if (closed != open.back()) {
+                throw make_error(
+                    "wrong group kind. expected: "
+                    + std::string(group_kind_name(open.back()))
+                    + ", got: " + group_kind_name(closed)
+                );
+            }
+            handler.leave_group(closed, at);
+            open.pop_back();
+            if (open.empty()) {
+                return;
+            }
+            break;
+        }
+        case token_kind::separator: {
+            auto ended = group_kind::command;
+            if (current.op == op_kind::colon) {
+                ended = group_kind::key;
+            } else if (current.word == ",") {
+                ended = group_kind::item;
+            }
+            handler.separator(ended, current);
+            break;
+        }
+        case token_kind::special_character:
+            if (current.op != op_kind::none) {
+                handler.op(current);
+            } else {
+                handler.value(current);
+            }
+            break;
+        default:
+            handler.value(current);
+        }
+    }
+}
+
+flat_tree grouper::parse_flat(const group_kind kind) {
+    return flat_tree { *parse(kind) };
 }
 
+size_t grouper::arena_bytes() const noexcept { return parsed_bytes; }
+
 void grouper::parse_group(const group_kind kind, group_ptr& group) {
-    auto top = std::make_shared<group_node>();
-    top->limit = limit;
+    // one frame per open bracket instead of one native call
+    struct frame {
+        group_kind kind;
+        group_ptr group;
+        group_ptr top;
+    };
+    const auto make_top = [this] {
+        auto top = arena->make<group_node>();
+        top->limit = limit;
+        top->byte_limit = byte_limit;
+        return top;
+    };
+    std::vector<frame> frames;
+    frames.push_back({ kind, group, make_top() });
     while (true) {
+        auto& f = frames.back();
         peek();
+        bool closed = false;
         if (current.kind == token_kind::separator) {
-            if (append_command(group, top, kind)) {
-                return;
-            }
+            closed = append_command(f.group, f.top, f.kind);
         } else if (current.kind == token_kind::open_bracket) {
-            append_wrapped(top);
+            if (frames.size() == 1) {
+                if (const auto body = take_prepared()) {
+                    append(f.top, body);
+                    continue;
+                }
+            }
+            if (frames.size() + nesting > lazy_depth) {
+                if (const auto skipped = skip_wrapped()) {
+                    append(f.top, skipped);
+                    continue;
+                }
+            }
+            const auto wn = append_wrapped(f.top);
+            frames.push_back({ wn->kind, wn, make_top() });
         } else if (current.kind == token_kind::close_bracket
                    || current.kind == token_kind::eof) {
-            close_wrapped(group, top, kind);
-            return;
+            const auto closes = current.kind == token_kind::eof
+                ? group_kind::file
+                : bracket_kind(current.word);
+            if (diagnostics == nullptr || f.kind == group_kind::halt
+                || closes == f.kind) {
+                close_wrapped(f.group, f.top, f.kind);
+                closed = true;
+            } else if (current.kind != token_kind::eof
+                       && std::none_of(
+                           frames.begin(), frames.end() - 1,
+                           [closes](const frame& outer) {
+                               return outer.kind == closes;
+                           }
+                       )) {
+                fail(
+                    "unbalanced close bracket: " + std::string(current.word),
+                    current.offset
+                );
+                current.kind = token_kind::error;
+                append(f.top, arena->make<token_node>(current));
+            } else {
+                // closed as if its partner stood here, the enclosing bracket
+                // then takes the token
+                if (frames.size() > 1) {
+                    fail(
+                        "bracket is never closed: "
+                            + std::string(opening(f.kind)),
+                        node_cast<wrapped_node>(f.group)->start
+                    );
+                    reuse = true;
+                } else {
+                    fail(
+                        "expected the end of a "
+                            + std::string(group_kind_name(f.kind)),
+                        current.offset
+                    );
+                }
+                append(f.group, f.top);
+                closed = true;
+            }
         } else {
-            auto tk = std::make_shared<token_node>();
-            tk->value = current;
-            append(top, tk);
+            append(f.top, arena->make<token_node>(current, symbol));
         }
+        if (!closed) {
+            continue;
+        }
+        if (frames.size() == 1) {
+            group = f.group;
+            return;
+        }
+        const auto done = f.group;
+        frames.pop_back();
+        append(frames.back().top, done);
     }
 }
 
+/// Report of @p node failing to be appended with @p error.
+static std::string append_failure(
+    const ast_node_ptr& node, const line_index& lines,
+    const std::exception& error
+) {
+    std::stringstream msg;
+    msg << "failed to append node: \n";
+    node->dump(msg, lines, "", true, false);
+    msg << error.what();
+    return msg.str();
+}
+
 void grouper::append(
     const group_ptr& parent, const ast_node_ptr& node,
     const std::source_location& location
 ) const {
     try {
-        parent->append(node, src);
+        parent->append(node, squeezing, *arena);
+    } catch (const budget_exceeded& e) {
+        // squeezed all it could; the parse that squeezed the region met the
+        // budget before identification made it larger
+        if (!eager) {
+            throw make_error(
+                append_failure(node, src.lines(), e), parent, location
+            );
+        }
     } catch (const std::runtime_error& e) {
-        std::stringstream msg;
-        msg << "failed to append node: \n";
-        node->dump(msg, "", true, false);
-        msg << e.what();
-        throw make_error(msg.str(), parent, location);
+        throw make_error(
+                append_failure(node, src.lines(), e), parent, location
+            );
     }
 }
 
@@ -97,81 +967,178 @@ void grouper::peek() {
         reuse = false;
         return;
     }
-    do {
-        pos = src.get_position();
+    if (stream != nullptr) {
+        // eof repeats once the stream is exhausted
+        const size_t index = std::min(cursor, stream->size() - 1);
+        stream->read(index, current);
+        symbol = stream->symbol(index);
+        cursor = std::min(cursor + 1, stream->size());
+        return;
+    }
+    src.skip_trivia();
+    src.next_token(current);
+    symbol = current.kind == token_kind::keyword
+        ? src.symbols()->intern(current.word)
+        : 0;
+}
+
+void grouper::open_stream(const bool lex) {
+    if (stream != nullptr || !src.is_resident()) {
+        return;
+    }
+    try {
+        stream = lex ? &src.tokens() : src.lexed();
+    } catch (const std::runtime_error&) {
+        // lex through the reader, which reports the error in context
+    }
+    if (stream != nullptr) {
+        cursor = stream->find(src.get_position().offset);
+    }
+}
+
+void grouper::check_balance() {
+    const bool lazy = lazy_depth != std::numeric_limits<size_t>::max();
+    if (stream == nullptr && !(lazy && src.is_resident())) {
+        return;
+    }
+    const auto bad = src.brackets().unbalanced();
+    const auto from = stream != nullptr ? stream->offset(cursor)
+                                        : src.get_position().offset;
+    if (!bad || static_cast<std::streamoff>(*bad) < from) {
+        return;
+    }
+    const auto at = static_cast<std::streamoff>(*bad);
+    const size_t resume = cursor;
+    const position back = src.get_position();
+    if (stream != nullptr) {
+        cursor = stream->find(at);
+        peek();
+    } else {
+        src.jump_to_position({ at, 0, 0 });
         src.next_token(current);
-    } while (current.kind == token_kind::whitespace
-             || current.kind == token_kind::comment);
+    }
+    if (current.kind == token_kind::open_bracket) {
+        throw make_error(
+            "bracket is never closed: " + std::string(current.word)
+        );
+    }
+    if (current.kind == token_kind::close_bracket) {
+        throw make_error(
+            "unbalanced close bracket: " + std::string(current.word)
+        );
+    }
+    // the lexer does not see a bracket there; the parse reports in context
+    if (stream != nullptr) {
+        cursor = resume;
+    } else {
+        src.jump_to_position(back);
+    }
 }
 
-group_ptr grouper::identify_subgroup(const group_ptr& group) const {
-    if (std::dynamic_pointer_cast<placeholder_node>(group)) {
-        return group;
+void grouper::sync() const {
+    if (!detached && stream != nullptr && cursor > 0) {
+        const auto end = stream->end(cursor - 1);
+        src.jump_to_position({ end, 0, 0 });
     }
+}
+
+group_ptr grouper::identify_subgroup(const group_ptr& group) const {
     group_ptr inode;
     const auto kind = group->kind;
     if (kind == group_kind::body || kind == group_kind::list
         || kind == group_kind::paren) {
-        inode = std::make_shared<wrapped_node>();
+        inode = arena->make<wrapped_node>();
     } else {
-        inode = std::make_shared<group_node>();
+        inode = arena->make<group_node>();
     }
     inode->limit = limit;
+    inode->byte_limit = byte_limit;
     inode->kind = kind;
-    identify(group, inode);
-    parse_arithmetic(inode);
+    if (const auto wn = node_cast<wrapped_node>(group)) {
+        const auto wrapped = node_cast<wrapped_node>(inode);
+        wrapped->start = wn->start;
+        wrapped->end = wn->end;
+    }
     return inode;
 }
 
+/// Reserved word of a control node, reserved::none for any other node.
+static reserved keyword_of(const ast_node_ptr& node) {
+    if (const auto ctrl = node_cast<control_node>(node)) {
+        return static_cast<reserved>(ctrl->symbol);
+    }
+    return reserved::none;
+}
+
+static std::string keyword_name(const reserved kw) {
+    return std::string(reserved_name(kw));
+}
+
+group_ptr grouper::restore(const placeholder_node& ph) const {
+    // not from the cache, the keyword changes the tree
+    const auto tree = ph.regroup();
+    arena->adopt(tree);
+    return group_ptr(tree.get());
+}
+
 bool grouper::handle_chain(
     const group_ptr& result, const group_ptr& inode
 ) const {
-    const auto first = inode->nodes.front();
-    std::string kw;
-    if (const auto ctrl = std::dynamic_pointer_cast<control_node>(first)) {
-        kw = ctrl->value.word;
-    } else if (const auto cond
-               = std::dynamic_pointer_cast<condition_node>(first)) {
-        kw = cond->value.word;
-    }
-    if (kw == "else" || kw == "elif" || kw == "catch" || kw == "finally") {
-        if (result->empty()) {
-            throw make_error("orphan secondary keyword: " + kw, inode);
-        }
-        const auto prev
-            = std::dynamic_pointer_cast<group_node>(result->nodes.back());
-        if (!prev || prev->nodes.empty() || prev->kind != group_kind::command) {
-            throw make_error("invalid predecessor for keyword: " + kw, inode);
-        }
-        const auto last = prev->nodes.back();
-        std::string prev_kw;
-        if (const auto ctrl = std::dynamic_pointer_cast<control_node>(last)) {
-            prev_kw = ctrl->value.word;
-        } else if (const auto cond
-                   = std::dynamic_pointer_cast<condition_node>(last)) {
-            prev_kw = cond->value.word;
-        } else {
-            throw make_error("invalid predecessor for keyword: " + kw, inode);
-        }
-        bool allowed = false;
-        if (kw == "else" || kw == "elif") {
-            allowed = (prev_kw == "if" || prev_kw == "elif");
-        } else if (kw == "catch" || kw == "finally") {
-            allowed = (prev_kw == "try" || prev_kw == "catch");
-        }
-        if (!allowed) {
-            throw make_error(
-                "unexpected keyword order: " + prev_kw + " before " + kw, inode
-            );
-        }
-        result->pop_back();
-        for (auto& ch : inode->nodes) {
-            append(prev, ch);
-        }
-        append(result, prev);
-        return true;
+    const auto kw = keyword_of(inode->nodes.front());
+    switch (kw) {
+    case reserved::kw_else:
+    case reserved::kw_elif:
+    case reserved::kw_catch:
+    case reserved::kw_finally:
+        break;
+    default:
+        return false;
     }
-    return false;
+    // a recovering parse keeps the keyword as a command of its own
+    const auto at = inode->nodes.front()->get_start();
+    if (result->empty()) {
+        fail("orphan secondary keyword: " + keyword_name(kw), at, inode);
+        return false;
+    }
+    auto prev = node_cast<group_node>(result->nodes.back());
+    // a command squeezed under a memory budget is read again to be joined
+    const auto squeezed = node_cast<placeholder_node>(prev);
+    if (squeezed && squeezed->kind == group_kind::command && !detached) {
+        prev = restore(*squeezed);
+    }
+    if (!prev || prev->nodes.empty() || prev->kind != group_kind::command) {
+        fail("invalid predecessor for keyword: " + keyword_name(kw), at, inode);
+        return false;
+    }
+    const auto prev_kw = keyword_of(prev->nodes.back());
+    if (prev_kw == reserved::none) {
+        fail("invalid predecessor for keyword: " + keyword_name(kw), at, inode);
+        return false;
+    }
+    bool allowed = false;
+    if (kw == reserved::kw_else || kw == reserved::kw_elif) {
+        allowed = prev_kw == reserved::kw_if || prev_kw == reserved::kw_elif;
+    } else {
+        allowed = prev_kw == reserved::kw_try || prev_kw == reserved::kw_catch;
+    }
+    if (!allowed) {
+        fail(
+            "unexpected keyword order: " + keyword_name(prev_kw) + " before "
+                + keyword_name(kw),
+            at, inode
+        );
+        return false;
+    }
+    result->pop_back();
+    if (squeezed && squeezed != prev) {
+        arena->release_node(*squeezed);
+    }
+    for (auto& ch : inode->nodes) {
+        append(prev, ch);
+    }
+    append(result, prev);
+    arena->release_node(*inode);
+    return true;
 }
 
 bool grouper::append_group(
@@ -181,7 +1148,7 @@ bool grouper::append_group(
     if (!result->empty()) {
         const auto top = result->nodes.back();
         result->pop_back();
-        if (const auto cond = std::dynamic_pointer_cast<condition_node>(top);
+        if (const auto cond = node_cast<condition_node>(top);
             cond && kind == group_kind::paren) {
             cond->set_paren(node);
             append(result, cond);
@@ -189,24 +1156,27 @@ bool grouper::append_group(
             wait_for_body = true;
             return true;
         }
-        if (const auto ctrl = std::dynamic_pointer_cast<control_node>(top);
+        if (const auto ctrl = node_cast<control_node>(top);
             ctrl && kind == group_kind::body) {
             wait_for_body = false;
             ctrl->set_body(node);
             append(result, ctrl);
             return true;
         }
-        if (const auto callexp = std::dynamic_pointer_cast<callexp_node>(top);
+        if (const auto callexp = node_cast<callexp_node>(top);
             callexp && kind == group_kind::body) {
-            const auto fundecl = std::make_shared<fundecl_node>(callexp);
+            const auto fundecl = arena->make<fundecl_node>(callexp);
+            arena->release_node(*callexp);
             fundecl->set_body(node);
             append(result, fundecl);
             return true;
         }
-        const auto tok = std::dynamic_pointer_cast<token_node>(top);
+        const auto tok = node_cast<token_node>(top);
         if (tok && tok->value.kind == token_kind::keyword
             && kind == group_kind::paren) {
-            const auto callexp = std::make_shared<callexp_node>(tok->value);
+            const auto callexp
+                = arena->make<callexp_node>(tok->value, tok->symbol);
+            arena->release_node(*tok);
             callexp->set_paren(node);
             append(result, callexp);
             return true;
@@ -217,20 +1187,22 @@ bool grouper::append_group(
 }
 
 void grouper::identify_body(const group_ptr& group) const {
-    const auto body = std::make_shared<group_node>();
+    const auto body = arena->make<group_node>();
     body->limit = limit;
+    body->byte_limit = byte_limit;
     while (!group->empty()) {
         auto top = group->nodes.back();
         group->pop_back();
-        if (auto tok = std::dynamic_pointer_cast<token_node>(top)) {
+        if (auto tok = node_cast<token_node>(top)) {
             if (const auto ctrl
-                = std::dynamic_pointer_cast<control_node>(tok)) {
+                = node_cast<control_node>(tok)) {
                 ctrl->set_body(body);
                 append(group, ctrl);
                 break;
             }
-            if (auto callexp = std::dynamic_pointer_cast<callexp_node>(tok)) {
-                const auto fundecl = std::make_shared<fundecl_node>(callexp);
+            if (auto callexp = node_cast<callexp_node>(tok)) {
+                const auto fundecl = arena->make<fundecl_node>(callexp);
+                arena->release_node(*callexp);
                 fundecl->set_body(body);
                 append(group, fundecl);
                 break;
@@ -241,99 +1213,170 @@ void grouper::identify_body(const group_ptr& group) const {
 }
 
 void grouper::identify(const group_ptr& group, const group_ptr& result) const {
-    bool wait_for_condition = false;
-    bool wait_for_body = false;
-
-    for (auto& node : group->nodes) {
-        bool is_group = false;
-        group_kind kind {};
-
-        if (auto sub = std::dynamic_pointer_cast<group_node>(node)) {
-            kind = sub->kind;
-            auto inode = identify_subgroup(sub);
-            node = inode;
-            is_group = true;
-
-            if ((kind == group_kind::halt || kind == group_kind::command)
-                && !inode->nodes.empty()) {
-                if (handle_chain(result, inode)) {
+    // one frame per nested group instead of one native call
+    struct frame {
+        group_ptr group;
+        group_ptr result;
+        size_t index;
+        bool wait_for_condition;
+        bool wait_for_body;
+    };
+    std::vector<frame> frames;
+    frames.push_back({ group, result, 0, false, false });
+    while (true) {
+        auto& f = frames.back();
+        if (f.index < f.group->nodes.size()) {
+            const auto& node = f.group->nodes[f.index];
+            const auto sub = node_cast<group_node>(node);
+            if (sub && !node_cast<placeholder_node>(sub)) {
+                const auto ready = identified.empty()
+                    ? identified.end()
+                    : identified.find(sub.get());
+                if (ready != identified.end()) {
+                    // identified by a worker of parse_parallel()
+                    const auto& body = *ready->second;
+                    arena->adopt(body.arena);
+                    f.group->nodes[f.index] = body.result;
+                    identify_node(
+                        f.result, body.result, sub->kind,
+                        f.wait_for_condition, f.wait_for_body
+                    );
+                    arena->release_node(*sub);
+                    ++f.index;
                     continue;
                 }
+                frames.push_back(
+                    { sub, identify_subgroup(sub), 0, false, false }
+                );
+                continue;
             }
+            identify_node(
+                f.result, node, sub ? sub->kind : std::optional<group_kind> {},
+                f.wait_for_condition, f.wait_for_body
+            );
+            ++f.index;
+            continue;
         }
-        if (wait_for_condition && (!is_group || kind != group_kind::paren)) {
-            throw make_error("expected condition after control keyword");
+        if (f.wait_for_body) {
+            identify_body(f.result);
         }
-        if (is_group) {
-            if (append_group(
-                    result, node, wait_for_condition, wait_for_body, kind
-                )) {
-                continue;
-            }
+        if (frames.size() == 1) {
+            return;
         }
-        if (const auto tok = std::dynamic_pointer_cast<token_node>(node)) {
-            if (tok->value.kind == token_kind::keyword) {
-                const auto& w = tok->value.word;
-                if (w == "if" || w == "elif" || w == "while" || w == "for"
-                    || w == "catch") {
-                    wait_for_condition = true;
-                    auto cond = std::make_shared<condition_node>(tok->value);
-                    append(result, cond);
-                    continue;
-                }
-                if (w == "else" || w == "try" || w == "finally") {
-                    wait_for_body = true;
-                    auto ctrl = std::make_shared<control_node>(tok->value);
-                    append(result, ctrl);
-                    continue;
-                }
-                if (w == "return" || w == "continue" || w == "break"
-                    || w == "goto") {
-                    auto jmp = std::make_shared<jump_node>(tok->value);
-                    append(result, jmp);
-                    wait_for_body = (w != "continue" && w != "break");
-                    continue;
-                }
-            }
+        const auto inode = f.result;
+        frames.pop_back();
+        parse_arithmetic(inode);
+        auto& parent = frames.back();
+        auto& node = parent.group->nodes[parent.index];
+        const auto kind = node_cast<group_node>(node)->kind;
+        arena->release_node(*node);
+        node = inode;
+        identify_node(
+            parent.result, node, kind, parent.wait_for_condition,
+            parent.wait_for_body
+        );
+        ++parent.index;
+    }
+}
+
+void grouper::identify_node(
+    const group_ptr& result, const ast_node_ptr& node,
+    const std::optional<group_kind> group, bool& wait_for_condition,
+    bool& wait_for_body
+) const {
+    const bool is_group = group.has_value();
+    const group_kind kind = group.value_or(group_kind {});
+    if (is_group && (kind == group_kind::halt || kind == group_kind::command)) {
+        if (const auto inode = node_cast<group_node>(node);
+            !inode->nodes.empty() && handle_chain(result, inode)) {
+            return;
         }
+    }
+    if (wait_for_condition && (!is_group || kind != group_kind::paren)) {
+        const auto* at = first_offset(*node);
+        fail(
+            "expected condition after control keyword",
+            at != nullptr ? *at : current.offset
+        );
+        wait_for_condition = false;
+    }
+    if (is_group
+        && append_group(
+            result, node, wait_for_condition, wait_for_body, kind
+        )) {
+        return;
+    }
+    const auto tok = node_cast<token_node>(node);
+    if (!tok || tok->value.kind != token_kind::keyword) {
         append(result, node);
+        return;
     }
-    if (wait_for_body) {
-        identify_body(result);
+    switch (const auto kw = static_cast<reserved>(tok->symbol)) {
+    case reserved::kw_if:
+    case reserved::kw_elif:
+    case reserved::kw_while:
+    case reserved::kw_for:
+    case reserved::kw_catch:
+        wait_for_condition = true;
+        append(result, arena->make<condition_node>(tok->value, tok->symbol));
+        arena->release_node(*tok);
+        break;
+    case reserved::kw_else:
+    case reserved::kw_try:
+    case reserved::kw_finally:
+        wait_for_body = true;
+        append(result, arena->make<control_node>(tok->value, tok->symbol));
+        arena->release_node(*tok);
+        break;
+    case reserved::kw_return:
+    case reserved::kw_continue:
+    case reserved::kw_break:
+    case reserved::kw_goto:
+        append(result, arena->make<jump_node>(tok->value, tok->symbol));
+        arena->release_node(*tok);
+        wait_for_body = kw != reserved::kw_continue && kw != reserved::kw_break;
+        break;
+    default:
+        append(result, node);
     }
 }
 
 bool grouper::append_command(
     group_ptr& group, group_ptr& top, const group_kind kind
 ) const {
-    if (current.word == ":") {
+    if (current.op == op_kind::colon) {
         top->kind = group_kind::key;
     } else if (current.word == ",") {
         top->kind = group_kind::item;
     } else if (current.word == ";") {
         top->kind = group_kind::command;
     } else {
-        throw make_error("unexpected separator: " + current.word, top);
+        throw make_error(
+            "unexpected separator: " + std::string(current.word), top
+        );
     }
     if (top->kind == kind) {
         if (group->empty()) {
+            arena->release_node(*group);
             group = top;
             return true;
         }
         append(group, top);
-        throw make_error(
+        fail(
             "wrong group kind. expected: " + std::string(group_kind_name(kind))
                 + ", got: " + group_kind_name(group->kind),
-            group
+            current.offset, group
         );
+        return true;
     }
     append(group, top);
-    top = std::make_shared<group_node>();
+    top = arena->make<group_node>();
     top->limit = limit;
+    top->byte_limit = byte_limit;
     return false;
 }
 
-void grouper::append_wrapped(const group_ptr& top) {
+group_ptr grouper::append_wrapped(const group_ptr& top) const {
     group_kind sub_kind;
     if (current.word == "{") {
         sub_kind = group_kind::body;
@@ -342,23 +1385,25 @@ void grouper::append_wrapped(const group_ptr& top) {
     } else if (current.word == "(") {
         sub_kind = group_kind::paren;
     } else {
-        throw make_error("unexpected open bracket: " + current.word, top);
+        throw make_error(
+            "unexpected open bracket: " + std::string(current.word), top
+        );
     }
-    const auto wn = std::make_shared<wrapped_node>();
-    wn->start = pos;
+    const auto wn = arena->make<wrapped_node>();
+    wn->start = current.offset;
     wn->limit = limit;
+    wn->byte_limit = byte_limit;
     wn->kind = sub_kind;
-    auto gr = std::dynamic_pointer_cast<group_node>(wn);
-    parse_group(sub_kind, gr);
-    append(top, gr);
+    return wn;
 }
 
 void grouper::close_wrapped(
-    const group_ptr& group, group_ptr& top, const group_kind kind
+    const group_ptr& group, const group_ptr& top, const group_kind kind
 ) {
     append(group, top);
-    top = std::make_shared<group_node>();
-    top->limit = limit;
+    if (const auto wn = node_cast<wrapped_node>(group)) {
+        wn->end = current.offset;
+    }
     if (current.kind == token_kind::eof) {
         group->kind = group_kind::file;
     } else if (current.word == "}") {
@@ -368,7 +1413,9 @@ void grouper::close_wrapped(
     } else if (current.word == ")") {
         group->kind = group_kind::paren;
     } else {
-        throw make_error("unexpected close bracket: " + current.word, group);
+        throw make_error(
+            "unexpected close bracket: " + std::string(current.word), group
+        );
     }
     if (kind == group_kind::halt) {
         reuse = true;
@@ -384,6 +1431,16 @@ void grouper::close_wrapped(
     );
 }
 
+void grouper::fail(
+    const std::string& message, const std::streamoff at,
+    const group_ptr& context, const std::source_location& location
+) const {
+    if (diagnostics == nullptr) {
+        throw make_error(message, context, location);
+    }
+    diagnostics->push_back({ src.lines().locate(at), message });
+}
+
 std::runtime_error grouper::make_error(
     const std::string& message, const group_ptr& context,
     const std::source_location& location
@@ -392,12 +1449,16 @@ std::runtime_error grouper::make_error(
     oss << "[Grouper-Error] " << message << ". " << std::endl;
     if (context) {
         oss << "during parsing of group:" << std::endl;
-        context->dump(oss, "\t", true, false);
+        context->dump(oss, src.lines(), "\t", true, false);
     }
     oss << "in file: " << location.file_name() << '(' << location.line() << ':'
         << location.column() << ") `" << location.function_name() << "`"
         << std::endl;
+    if (detached) {
+        return std::runtime_error(oss.str());
+    }
     try {
+        sync();
         src.interrupt();
     } catch (const std::runtime_error& e) {
         oss << e.what();
@@ -405,52 +1466,83 @@ std::runtime_error grouper::make_error(
     return std::runtime_error(oss.str());
 }
 
+void grouper::release_operators(
+    const std::vector<ast_node_ptr>& nodes
+) const {
+    // the expression nodes hold copies of the operator tokens
+    for (const auto& node : nodes) {
+        if (expression::operator_of(node) != nullptr) {
+            arena->release_node(*node);
+        }
+    }
+}
+
 void grouper::parse_arithmetic(const group_ptr& group) const {
+    // a recovering parse keeps a malformed expression as its tokens
+    const auto parse = [this, &group](const auto& nodes, size_t& idx) {
+        try {
+            return expression::parse_expression(
+                nodes, idx, 0, *arena, expressions
+            );
+        } catch (const std::runtime_error& e) {
+            if (diagnostics == nullptr) {
+                throw;
+            }
+            const auto* at = first_offset(*group);
+            fail(e.what(), at != nullptr ? *at : current.offset);
+            return ast_node_ptr {};
+        }
+    };
     if (group->kind == group_kind::key && group->size() == 2) {
         const auto left_g
-            = std::dynamic_pointer_cast<group_node>(group->nodes[0]);
+            = node_cast<group_node>(group->nodes[0]);
         const auto right_g
-            = std::dynamic_pointer_cast<group_node>(group->nodes[1]);
+            = node_cast<group_node>(group->nodes[1]);
         bool has_q = false;
         if (left_g) {
             for (auto& ch : left_g->nodes) {
-                if (const auto tn = std::dynamic_pointer_cast<token_node>(ch);
-                    tn && tn->value.word == "?") {
+                if (const auto tn = node_cast<token_node>(ch);
+                    tn && tn->value.op == op_kind::question) {
                     has_q = true;
                     break;
                 }
             }
         }
         if (has_q) {
-            std::vector<ast_node_ptr> combined;
+            // both sides joined by the colon the key group consumed
+            auto& input = expressions.input;
+            input.clear();
             if (left_g) {
-                combined.insert(
-                    combined.end(), left_g->nodes.begin(), left_g->nodes.end()
+                input.insert(
+                    input.end(), left_g->nodes.begin(), left_g->nodes.end()
                 );
             } else {
-                combined.push_back(group->nodes[0]);
+                input.push_back(group->nodes[0]);
             }
-            auto colon_tn = std::make_shared<token_node>();
-            colon_tn->value.kind = token_kind::separator;
-            colon_tn->value.word = ":";
-            colon_tn->value.pos = group->nodes[1]->get_start();
-            combined.push_back(colon_tn);
+            auto& colon = expressions.colon.value;
+            colon.kind = token_kind::separator;
+            colon.word = ":";
+            colon.op = op_kind::colon;
+            colon.offset = group->nodes[1]->get_start();
+            input.emplace_back(&expressions.colon);
             if (right_g) {
-                combined.insert(
-                    combined.end(), right_g->nodes.begin(), right_g->nodes.end()
+                input.insert(
+                    input.end(), right_g->nodes.begin(), right_g->nodes.end()
                 );
             } else {
-                combined.push_back(group->nodes[1]);
+                input.push_back(group->nodes[1]);
             }
-            auto items = expression::make_items(combined);
             size_t idx = 0;
-            auto expr = expression::parse_expression(items, idx, 0);
-            if (idx == items.size()) {
-                group->nodes.clear();
-                group->weights = {};
-                group->fixed_size = 1;
-                group->full_size = 1;
-                group->append(expr, src);
+            const auto expr = parse(input, idx);
+            if (expr && idx == input.size()) {
+                group->clear();
+                group->append(expr, squeezing, *arena);
+                release_operators(input);
+                for (const auto& side : { left_g, right_g }) {
+                    if (side) {
+                        arena->release_node(*side);
+                    }
+                }
             }
             return;
         }
@@ -462,15 +1554,15 @@ void grouper::parse_arithmetic(const group_ptr& group) const {
         if (group->nodes.empty()) {
             return;
         }
-        auto items = expression::make_items(group->nodes);
+        // kept apart from the group, which clear() empties
+        auto& input = expressions.input;
+        input.assign(group->nodes.begin(), group->nodes.end());
         size_t idx = 0;
-        auto expr = expression::parse_expression(items, idx, 0);
-        if (idx == items.size()) {
-            group->nodes.clear();
-            group->weights = {};
-            group->fixed_size = 1;
-            group->full_size = 1;
+        const auto expr = parse(input, idx);
+        if (expr && idx == input.size()) {
+            group->clear();
             append(group, expr);
+            release_operators(input);
         }
     }
 }
@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "interner.hpp"
+
+#include <array>
+#include <mutex>
+
+/// spellings by reserved id, starting with reserved::none
+static constexpr std::array<std::string_view, 13> reserved_words {
+    "", "if", "elif", "else", "while", "for", "catch", "try", "finally",
+    "return", "continue", "break", "goto"
+};
+
+reserved reserved_word(const std::string_view word) noexcept {
+    for (size_t id = 1; id < reserved_words.size(); ++id) {
+        if (reserved_words[id] == word) {
+            return static_cast<reserved>(id);
+        }
+    }
+    return reserved::none;
+}
+
+std::string_view reserved_name(const reserved kw) noexcept {
+    const auto id = static_cast<size_t>(kw);
+    return id < reserved_words.size() ? reserved_words[id]
+                                      : std::string_view {};
+}
+
+interner::interner() {
+    // reserved words are resolved by reserved_word(), but keep their ids
+    for (const std::string_view word : reserved_words) {
+        names.emplace_back(word);
+    }
+}
+
+uint32_t interner::intern(const std::string_view name) {
+    if (const auto kw = reserved_word(name); kw != reserved::none) {
+        return static_cast<uint32_t>(kw);
+    }
+    {
+        std::shared_lock lock { mutex };
+        if (const auto it = ids.find(name); it != ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock lock { mutex };
+    if (const auto it = ids.find(name); it != ids.end()) {
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+std::string_view interner::name(const uint32_t id) const {
+    std::shared_lock lock { mutex };
+    return id < names.size() ? std::string_view { names[id] }
+                             : std::string_view {};
+}
+
+size_t interner::size() const {
+    std::shared_lock lock { mutex };
+    return names.size();
+}
@@ -0,0 +1,347 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "lexer.hpp"
+
+#include "interner.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+size_t token_columns::size() const noexcept { return kinds.size(); }
+
+std::streamoff token_columns::end(const size_t index) const noexcept {
+    return std::streamoff { offsets[index] } + lengths[index];
+}
+
+void token_columns::push_back(const token& t, interner& table) {
+    const auto idx = static_cast<uint32_t>(kinds.size());
+    size_t length = t.word.size();
+    if (t.kind == token_kind::string) {
+        length += 2;
+        if (t.word.find('\\') != std::string_view::npos) {
+            literals.emplace_back(idx, t.text());
+        }
+    } else if (t.kind == token_kind::integer
+               || t.kind == token_kind::floating) {
+        numbers.emplace_back(idx, t.number());
+    }
+    kinds.push_back(static_cast<uint8_t>(t.kind));
+    ops.push_back(t.op);
+    const bool keyword = t.kind == token_kind::keyword;
+    symbols.push_back(keyword ? table.intern(t.word) : 0);
+    offsets.push_back(static_cast<uint32_t>(t.offset));
+    lengths.push_back(static_cast<uint32_t>(length));
+}
+
+/// Append the entries of @p from keyed at @p first or later, re-keyed.
+template <typename Value>
+static void append_side(
+    std::vector<std::pair<uint32_t, Value>>& to,
+    const std::vector<std::pair<uint32_t, Value>>& from, const size_t first,
+    const size_t base
+) {
+    auto it = std::lower_bound(
+        from.begin(), from.end(), first,
+        [](const auto& entry, const size_t i) { return entry.first < i; }
+    );
+    for (; it != from.end(); ++it) {
+        to.emplace_back(
+            static_cast<uint32_t>(it->first - first + base), it->second
+        );
+    }
+}
+
+void token_columns::append(const token_columns& other, const size_t first) {
+    const size_t base = size();
+    const auto from = static_cast<std::ptrdiff_t>(first);
+    kinds.insert(kinds.end(), other.kinds.begin() + from, other.kinds.end());
+    ops.insert(ops.end(), other.ops.begin() + from, other.ops.end());
+    offsets.insert(
+        offsets.end(), other.offsets.begin() + from, other.offsets.end()
+    );
+    lengths.insert(
+        lengths.end(), other.lengths.begin() + from, other.lengths.end()
+    );
+    symbols.insert(
+        symbols.end(), other.symbols.begin() + from, other.symbols.end()
+    );
+    append_side(literals, other.literals, first, base);
+    append_side(numbers, other.numbers, first, base);
+}
+
+/// Tokens lexed speculatively from the first byte of a chunk.
+struct chunk_tokens {
+    std::streamoff begin {};
+    std::streamoff end {};
+    token_columns tokens;
+    /// private table of the chunk, so the workers never share a lock
+    std::shared_ptr<interner> symbols;
+    /// ids in the stitched table by chunk id, 0 until first needed
+    std::vector<uint32_t> rebound;
+};
+
+/// Re-id the symbols of @p out from @p first on from @p chunk into @p table.
+static void rebind_symbols(
+    token_columns& out, const size_t first, chunk_tokens& chunk,
+    interner& table
+) {
+    constexpr auto last_reserved = static_cast<uint32_t>(reserved::kw_goto);
+    for (size_t i = first; i < out.size(); ++i) {
+        const uint32_t id = out.symbols[i];
+        if (id <= last_reserved) {
+            continue;
+        }
+        if (chunk.rebound.size() <= id) {
+            chunk.rebound.resize(chunk.symbols->size(), 0);
+        }
+        if (chunk.rebound[id] == 0) {
+            chunk.rebound[id] = table.intern(chunk.symbols->name(id));
+        }
+        out.symbols[i] = chunk.rebound[id];
+    }
+}
+
+static void lex_chunk(
+    const std::string_view text, const bool keep_trivia, chunk_tokens& chunk
+) {
+    reader r { borrowed_source, text };
+    chunk.symbols = r.symbols();
+    try {
+        r.jump_to_position({ chunk.begin, 0, 0 });
+        token t;
+        while (true) {
+            if (!keep_trivia) {
+                r.skip_trivia();
+            }
+            if (r.get_position().offset >= chunk.end) {
+                break;
+            }
+            r.next_token(t);
+            if (t.kind == token_kind::eof) {
+                break;
+            }
+            chunk.tokens.push_back(t, *chunk.symbols);
+        }
+    } catch (const std::runtime_error&) {
+        // a wrong guess about the state at chunk.begin, or a real error that
+        // the sequential stitcher will report in order
+    }
+}
+
+void lexer::tokenize(
+    const reader& src, token_columns& out, const bool keep_trivia,
+    const unsigned threads, const size_t chunk_size
+) {
+    if (!src.is_resident()) {
+        throw std::runtime_error(
+            "[Lexer-Error] whole-input tokenization requires a resident source"
+        );
+    }
+    const std::string_view text = src.source();
+    if (text.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error(
+            "[Lexer-Error] source is too large for a token stream"
+        );
+    }
+    int workers = static_cast<int>(threads);
+#ifdef _OPENMP
+    if (workers == 0) {
+        workers = omp_get_max_threads();
+    }
+#endif
+    workers = std::max(workers, 1);
+
+    const size_t step = std::max<size_t>(chunk_size, 1);
+    std::vector<chunk_tokens> chunks((text.size() + step - 1) / step);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].begin = static_cast<std::streamoff>(i * step);
+        const size_t end = std::min(text.size(), (i + 1) * step);
+        chunks[i].end = static_cast<std::streamoff>(end);
+    }
+    const auto count = static_cast<std::ptrdiff_t>(chunks.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(workers)
+#endif
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        lex_chunk(text, keep_trivia, chunks[static_cast<size_t>(i)]);
+    }
+
+    reader seq { borrowed_source, text };
+    seq.set_symbols(src.symbols());
+    std::streamoff cursor = 0;
+    token t;
+    const auto lex_next = [&] {
+        seq.jump_to_position({ cursor, 0, 0 });
+        if (!keep_trivia) {
+            seq.skip_trivia();
+        }
+        seq.next_token(t);
+        cursor = seq.get_position().offset;
+        out.push_back(t, *src.symbols());
+    };
+    for (auto& chunk : chunks) {
+        const auto& offsets = chunk.tokens.offsets;
+        while (cursor < chunk.end) {
+            seq.jump_to_position({ cursor, 0, 0 });
+            if (!keep_trivia) {
+                seq.skip_trivia();
+            }
+            const auto start = seq.get_position().offset;
+            if (start >= chunk.end) {
+                break;
+            }
+            const auto it = std::lower_bound(
+                offsets.begin(), offsets.end(), start,
+                [](const uint32_t from, const std::streamoff offset) {
+                    return std::streamoff { from } < offset;
+                }
+            );
+            if (it != offsets.end() && std::streamoff { *it } == start) {
+                const size_t base = out.size();
+                out.append(
+                    chunk.tokens, static_cast<size_t>(it - offsets.begin())
+                );
+                rebind_symbols(out, base, chunk, *src.symbols());
+                cursor = chunk.tokens.end(chunk.tokens.size() - 1);
+                continue;
+            }
+            lex_next();
+        }
+        // release the chunk as soon as it is stitched
+        chunk.tokens = {};
+        chunk.symbols.reset();
+        chunk.rebound = {};
+    }
+    do {
+        lex_next();
+    } while (t.kind != token_kind::eof);
+}
+
+std::vector<token> lexer::tokenize(
+    const reader& src, const bool keep_trivia, const unsigned threads,
+    const size_t chunk_size
+) {
+    token_columns columns;
+    tokenize(src, columns, keep_trivia, threads, chunk_size);
+    const std::string_view text = src.source();
+    std::vector<token> result(columns.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        auto& tk = result[i];
+        tk.kind = static_cast<token_kind>(columns.kinds[i]);
+        tk.op = columns.ops[i];
+        tk.offset = columns.offsets[i];
+        tk.word = text.substr(columns.offsets[i], columns.lengths[i]);
+        if (tk.kind == token_kind::string) {
+            tk.word = tk.word.substr(1, tk.word.size() - 2);
+        }
+    }
+    return result;
+}
+
+token_stream::token_stream(const reader& src, const unsigned threads)
+    : text(src.source()) {
+    lexer::tokenize(src, columns, false, threads);
+}
+
+size_t token_stream::size() const noexcept { return columns.size(); }
+
+token_kind token_stream::kind(const size_t index) const noexcept {
+    return static_cast<token_kind>(columns.kinds[index]);
+}
+
+op_kind token_stream::op(const size_t index) const noexcept {
+    return columns.ops[index];
+}
+
+uint32_t token_stream::symbol(const size_t index) const noexcept {
+    return columns.symbols[index];
+}
+
+std::streamoff token_stream::offset(const size_t index) const noexcept {
+    return columns.offsets[index];
+}
+
+std::streamoff token_stream::end(const size_t index) const noexcept {
+    return columns.end(index);
+}
+
+std::string_view token_stream::word(const size_t index) const noexcept {
+    if (kind(index) == token_kind::string) {
+        return text.substr(
+            columns.offsets[index] + 1, columns.lengths[index] - 2
+        );
+    }
+    return text.substr(columns.offsets[index], columns.lengths[index]);
+}
+
+std::string_view token_stream::literal(const size_t index) const noexcept {
+    if (kind(index) == token_kind::string) {
+        const auto it = std::lower_bound(
+            columns.literals.begin(), columns.literals.end(), index,
+            [](const auto& entry, const size_t i) { return entry.first < i; }
+        );
+        if (it != columns.literals.end() && it->first == index) {
+            return it->second;
+        }
+    }
+    return word(index);
+}
+
+numeric_value token_stream::number(const size_t index) const noexcept {
+    const auto it = std::lower_bound(
+        columns.numbers.begin(), columns.numbers.end(), index,
+        [](const auto& entry, const size_t i) { return entry.first < i; }
+    );
+    if (it != columns.numbers.end() && it->first == index) {
+        return it->second;
+    }
+    return {};
+}
+
+size_t token_stream::find(const std::streamoff offset) const noexcept {
+    const auto& offsets = columns.offsets;
+    const auto it = std::lower_bound(
+        offsets.begin(), offsets.end(), offset,
+        [](const uint32_t start, const std::streamoff off) {
+            return std::streamoff { start } < off;
+        }
+    );
+    return std::min(
+        static_cast<size_t>(it - offsets.begin()), offsets.size() - 1
+    );
+}
+
+void token_stream::read(const size_t index, token& out) const {
+    out.kind = kind(index);
+    out.op = op(index);
+    out.offset = offset(index);
+    out.word = word(index);
+}
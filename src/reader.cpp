@@ -24,61 +24,365 @@
 
 #include "reader.hpp"
 
+#include "bracket_index.hpp"
+#include "interner.hpp"
+#include "lexer.hpp"
+#include "scanner.hpp"
+
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define QPILER_HAS_MMAP 1
+#endif
+
+line_index::line_index(const std::string_view text) { append(text); }
+
+void line_index::append(const std::string_view text) {
+    scanner::line_starts(text, starts, covered);
+    covered += text.size();
+}
+
+position line_index::locate(const std::streamoff offset, const int hint) const {
+    const auto at = static_cast<size_t>(offset);
+    auto line = static_cast<size_t>(hint);
+    const auto fits = [&](const size_t l) {
+        return l < starts.size() && starts[l] <= at
+            && (l + 1 == starts.size() || at < starts[l + 1]);
+    };
+    if (!fits(line) && !fits(++line)) {
+        const auto it = std::upper_bound(starts.begin(), starts.end(), at);
+        line = static_cast<size_t>(it - starts.begin()) - 1;
+    }
+    return { offset, static_cast<int>(line),
+             static_cast<int>(at - starts[line]) };
+}
+
+size_t line_index::lines() const noexcept { return starts.size(); }
+
+size_t line_index::size() const noexcept { return covered; }
 
 token::~token() = default;
 
+static std::string encode_utf8(const char32_t cp) {
+    std::string out;
+    if (cp <= 0x7F) {
+        out += static_cast<char>(cp);
+    } else if (cp <= 0x7FF) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp <= 0xFFFF) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+std::string token::text() const {
+    if (kind != token_kind::string
+        || word.find('\\') == std::string_view::npos) {
+        return std::string(word);
+    }
+    std::string out;
+    out.reserve(word.size());
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (word[i] != '\\' || i + 1 == word.size()) {
+            out += word[i];
+            continue;
+        }
+        switch (const char escaped = word[++i]) {
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u': {
+            const auto hex = word.substr(i + 1, 4);
+            out += encode_utf8(
+                static_cast<char32_t>(std::stoul(std::string(hex), nullptr, 16))
+            );
+            i += hex.size();
+            break;
+        }
+        default:
+            out += escaped;
+        }
+    }
+    return out;
+}
+
 static const char* token_kind_name(const token_kind k) noexcept {
     static constexpr const char* names[]
         = { "eof",     "open_bracket", "close_bracket",    "separator",
             "keyword", "string",       "comment",          "whitespace",
-            "integer", "floating",     "special_character" };
+            "integer", "floating",     "special_character", "error" };
     return names[static_cast<size_t>(k)];
 }
 
 void token::dump(
-    std::ostream& os, const std::string& prefix, const bool is_last
-) const noexcept {
+    std::ostream& os, const line_index& lines, const std::string& prefix,
+    const bool is_last
+) const {
+    const position pos = lines.locate(offset);
     os << prefix << (is_last ? "`-" : "|-") << "Token(" << token_kind_name(kind)
-       << ") <" << pos.line << ":" << pos.column << ">(\"" << word << "\")\n";
+       << ") <" << pos.line << ":" << pos.column << ">(\"";
+    if (kind == token_kind::string) {
+        os << text();
+    } else {
+        os << word;
+    }
+    os << "\")\n";
 }
 
-void token::dump(std::ostream& os) const noexcept { dump(os, "", true); }
+void token::dump(std::ostream& os, const line_index& lines) const {
+    dump(os, lines, "", true);
+}
 
 reader::reader(
-    const std::filesystem::path& path, const std::streamsize buffer_size
+    const std::filesystem::path& path, const std::streamsize buffer_size,
+    const input_mode mode
 )
-    : max_buffer_size(buffer_size) {
-    ifs.open(path, std::ios::in | std::ios::binary);
+    : max_buffer_size(buffer_size)
+    , symbol_table(std::make_shared<interner>()) {
     filename = path.string();
+    if (buffer_size <= 0) {
+        throw std::invalid_argument("buffer size must be positive");
+    }
+    if (mode == input_mode::mapped && map_file(path)) {
+        return;
+    }
+    ifs.open(path, std::ios::in | std::ios::binary);
     if (!ifs.is_open()) {
         throw std::invalid_argument("cannot open file: " + filename);
     }
     ifs.seekg(0, std::ios::beg);
     file_offset = ifs.tellg();
-    buffer.resize(static_cast<size_t>(max_buffer_size));
     reload_buffer();
 }
 
-reader::reader(std::string& data) noexcept
-    : buffer(std::move(data)) {
+reader::reader(std::string& data)
+    : buffer(std::move(data))
+    , input(buffer)
+    , symbol_table(std::make_shared<interner>()) {
     if (!buffer.empty()) {
         line = 0;
         column = 0;
     }
 }
 
+reader::reader(borrowed_source_t, const std::string_view source)
+    : input(source)
+    , symbol_table(std::make_shared<interner>()) { }
+
 reader::~reader() {
+#ifdef QPILER_HAS_MMAP
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+#endif
     if (ifs.is_open()) {
         ifs.close();
     }
 }
 
+bool reader::map_file([[maybe_unused]] const std::filesystem::path& path) {
+#ifdef QPILER_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st { };
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    mapping = addr;
+    mapping_size = size;
+    input = { static_cast<const char*>(addr), size };
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool reader::is_mapped() const noexcept { return mapping != nullptr; }
+
+const token_stream& reader::tokens() {
+    if (lex_error) {
+        throw *lex_error;
+    }
+    if (!stream) {
+        try {
+            stream = std::make_unique<token_stream>(*this);
+        } catch (const std::runtime_error& e) {
+            lex_error = std::make_unique<std::runtime_error>(e);
+            throw;
+        }
+    }
+    return *stream;
+}
+
+const token_stream* reader::lexed() const noexcept { return stream.get(); }
+
+const bracket_index& reader::brackets() {
+    if (!is_resident()) {
+        throw make_error("bracket index requires a resident source");
+    }
+    if (!bracket_pairs) {
+        bracket_pairs = std::make_unique<bracket_index>(input);
+    }
+    return *bracket_pairs;
+}
+
+void reader::edit(const text_edit& edit) {
+    if (!is_resident()) {
+        throw make_error("editing requires a resident source");
+    }
+    if (edit.offset > input.size()
+        || edit.removed > input.size() - edit.offset) {
+        throw make_error("edit is out of range");
+    }
+    const size_t size = input.size() - edit.removed + edit.inserted.size();
+    if (input.data() == buffer.data() && size <= buffer.capacity()) {
+        // in place, so tokens before the edit keep viewing valid text
+        buffer.replace(edit.offset, edit.removed, edit.inserted);
+    } else {
+        std::string next;
+        // with room for later edits to be made in place
+        next.reserve(size + size / 2);
+        next.append(input.substr(0, edit.offset));
+        next.append(edit.inserted);
+        next.append(input.substr(edit.offset + edit.removed));
+        buffer = std::move(next);
+    }
+    input = buffer;
+#ifdef QPILER_HAS_MMAP
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+#endif
+    index.reset();
+    stream.reset();
+    lex_error.reset();
+    bracket_pairs.reset();
+    buffer_position = 0;
+    token_start = std::string_view::npos;
+    line = 0;
+    column = 0;
+}
+
+void reader::relocate(token& t) const noexcept {
+    auto at = static_cast<size_t>(t.offset);
+    if (t.kind == token_kind::string) {
+        ++at;
+    }
+    if (at <= input.size()) {
+        t.word = input.substr(at, t.word.size());
+    }
+}
+
+void reader::set_diagnostics(std::vector<diagnostic>* diagnostics) noexcept {
+    sink = diagnostics;
+}
+
+std::vector<diagnostic>* reader::diagnostics() const noexcept { return sink; }
+
+const std::shared_ptr<interner>& reader::symbols() const noexcept {
+    return symbol_table;
+}
+
+void reader::set_symbols(std::shared_ptr<interner> table) noexcept {
+    symbol_table = std::move(table);
+}
+
+void reader::set_retain_chunks(const bool retain_chunks) noexcept {
+    retain = retain_chunks;
+}
+
+bool reader::is_resident() const noexcept { return !ifs.is_open(); }
+
+std::string_view reader::source() const noexcept {
+    return is_resident() ? input : std::string_view {};
+}
+
+const line_index& reader::lines() {
+    if (!index) {
+        if (is_resident()) {
+            index = std::make_unique<line_index>(input);
+        } else {
+            index = std::make_unique<line_index>();
+            extend_index();
+        }
+        line = get_position().line;
+    }
+    return *index;
+}
+
+const line_index* reader::indexed() const noexcept { return index.get(); }
+
+void reader::extend_index() {
+    auto covered = static_cast<std::streamoff>(index->size());
+    if (covered < file_offset) {
+        // the bytes before the chunk are read once more
+        std::ifstream again { filename, std::ios::in | std::ios::binary };
+        again.seekg(covered, std::ios::beg);
+        std::string block;
+        while (covered < file_offset) {
+            block.resize(static_cast<size_t>(
+                std::min<std::streamoff>(max_buffer_size, file_offset - covered)
+            ));
+            const auto size = static_cast<std::streamsize>(block.size());
+            again.read(block.data(), size);
+            if (again.gcount() <= 0) {
+                return;
+            }
+            block.resize(static_cast<size_t>(again.gcount()));
+            index->append(block);
+            covered += again.gcount();
+        }
+    }
+    const auto end = file_offset + static_cast<std::streamoff>(input.size());
+    if (covered < end) {
+        index->append(input.substr(static_cast<size_t>(covered - file_offset)));
+    }
+}
+
 bool reader::is_valid() const noexcept {
-    return !buffer.empty() && buffer_position < buffer.size();
+    return !input.empty() && buffer_position < input.size();
 }
 
-char reader::peek_char() const noexcept { return buffer[buffer_position]; }
+char reader::peek_char() const noexcept { return input[buffer_position]; }
 
 unsigned char reader::peek_uchar() const noexcept {
     return static_cast<unsigned char>(peek_char());
@@ -91,10 +395,26 @@ char reader::get_char() {
 }
 
 void reader::advance_char() {
-    assert(!buffer.empty());
+    assert(!input.empty());
     ++buffer_position;
     ++column;
-    if (buffer_position >= buffer.size()) {
+    if (buffer_position >= input.size()) {
+        reload_buffer();
+    }
+}
+
+void reader::advance_run(const size_t length) {
+    if (!index) {
+        const auto run = input.substr(buffer_position, length);
+        if (const auto newlines = scanner::count_newlines(run); newlines > 0) {
+            line += static_cast<int>(newlines);
+            column = static_cast<int>(length - 1 - run.rfind('\n'));
+        } else {
+            column += static_cast<int>(length);
+        }
+    }
+    buffer_position += length;
+    if (buffer_position >= input.size()) {
         reload_buffer();
     }
 }
@@ -103,60 +423,80 @@ void reader::reload_buffer() {
     if (!ifs.is_open() || ifs.eof()) {
         return;
     }
-    file_offset = ifs.tellg();
-    buffer.resize(static_cast<size_t>(max_buffer_size));
-    ifs.read(buffer.data(), max_buffer_size);
+    // the chunk can be refilled in place unless tokens still view into it
+    const bool reuse = chunk && !(retain && viewed);
+    if (chunk && !reuse) {
+        retained.push_back(std::move(chunk));
+    }
+    auto next = reuse ? std::move(chunk) : std::make_unique<std::string>();
+    viewed = false;
+    size_t keep = 0;
+    if (token_start < input.size()) {
+        keep = input.size() - token_start;
+        if (reuse) {
+            next->erase(0, token_start);
+        } else {
+            next->assign(input.substr(token_start));
+        }
+        token_start = 0;
+    }
+    file_offset = ifs.tellg() - static_cast<std::streamoff>(keep);
+    next->resize(keep + static_cast<size_t>(max_buffer_size));
+    ifs.read(next->data() + keep, max_buffer_size);
     const auto got = ifs.gcount();
-    buffer.resize(static_cast<size_t>(got));
-    buffer_position = 0;
+    next->resize(keep + static_cast<size_t>(got));
+    chunk = std::move(next);
+    input = *chunk;
+    buffer_position = keep;
+    if (index) {
+        extend_index();
+    }
 }
 
-void reader::read_whitespace(std::string& into) {
-    into.clear();
-    while (is_valid() && std::isspace(peek_uchar())) {
-        if (peek_char() == '\n') {
-            ++line;
-            column = -1;
+void reader::read_run(size_t (*scan)(std::string_view) noexcept) {
+    while (is_valid()) {
+        const auto rest = input.substr(buffer_position);
+        const size_t length = scan(rest);
+        advance_run(length);
+        if (length < rest.size()) {
+            break;
         }
-        into += get_char();
     }
 }
 
-void reader::read_keyword(std::string& into) {
-    into.clear();
-    do {
-        into += get_char();
-    } while (is_valid() && (std::isalnum(peek_uchar()) || peek_char() == '_'));
-}
+void reader::read_whitespace() { read_run(scanner::whitespace_run); }
+
+void reader::read_keyword() { read_run(scanner::identifier_run); }
 
-void reader::read_comment(std::string& into) {
-    assert(is_valid() && into.size() == 1 && into[0] == '/');
-    into += get_char();
-    const bool is_multiline = into.back() == '*';
+void reader::read_comment() {
+    assert(is_valid() && (peek_char() == '/' || peek_char() == '*'));
+    const bool is_multiline = get_char() == '*';
+    char previous = '\0';
     while (is_valid()) {
-        const char current_char = get_char();
-        if (is_multiline && current_char == '/' && into.back() == '*'
-            && into.size() > 2) {
-            into += current_char;
-            return;
-        }
-        into += current_char;
-        if (current_char == '\n') {
-            ++line;
-            column = -1;
-            if (!is_multiline) {
-                column = 0;
-                break;
+        const auto rest = input.substr(buffer_position);
+        if (!is_multiline) {
+            if (const auto end = rest.find('\n'); end != rest.npos) {
+                advance_run(end + 1);
+                return;
             }
+        } else {
+            for (auto slash = rest.find('/'); slash != rest.npos;
+                 slash = rest.find('/', slash + 1)) {
+                if ((slash == 0 ? previous : rest[slash - 1]) == '*') {
+                    advance_run(slash + 1);
+                    return;
+                }
+            }
+            previous = rest.back();
         }
+        advance_run(rest.size());
     }
     if (is_multiline) {
         throw make_error("missing closing comment delimiter");
     }
 }
 
-void reader::read_string(std::string& into) {
-    into.clear();
+void reader::read_string() {
     const char quote = get_char();
     bool escaped = false;
     while (is_valid()) {
@@ -164,69 +504,23 @@ void reader::read_string(std::string& into) {
         if (escaped) {
             switch (current_char) {
             case '"':
-                into += '"';
-                break;
             case '\'':
-                into += '\'';
-                break;
             case '\\':
-                into += '\\';
-                break;
             case '/':
-                into += '/';
-                break;
             case 'b':
-                into += '\b';
-                break;
             case 'f':
-                into += '\f';
-                break;
             case 'n':
-                into += '\n';
-                break;
             case 'r':
-                into += '\r';
-                break;
             case 't':
-                into += '\t';
                 break;
-            case 'u': {
-                std::string hex;
+            case 'u':
                 for (int i = 0; i < 4; ++i) {
                     advance_char();
                     if (!is_valid() || !std::isxdigit(peek_uchar())) {
                         throw make_error("invalid Unicode escape");
                     }
-                    hex += peek_char();
                 }
-                // const int codepoint = std::stoi(hex, nullptr, 16);
-                // std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t>
-                //     converter;
-                // into += converter.to_bytes(static_cast<char32_t>(codepoint));
-                const auto codepoint
-                    = static_cast<char32_t>(std::stoul(hex, nullptr, 16));
-                auto encode = [](const char32_t cp) {
-                    std::string out;
-                    if (cp <= 0x7F) {
-                        out += static_cast<char>(cp);
-                    } else if (cp <= 0x7FF) {
-                        out += static_cast<char>(0xC0 | (cp >> 6));
-                        out += static_cast<char>(0x80 | (cp & 0x3F));
-                    } else if (cp <= 0xFFFF) {
-                        out += static_cast<char>(0xE0 | (cp >> 12));
-                        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
-                        out += static_cast<char>(0x80 | (cp & 0x3F));
-                    } else {
-                        out += static_cast<char>(0xF0 | (cp >> 18));
-                        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
-                        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
-                        out += static_cast<char>(0x80 | (cp & 0x3F));
-                    }
-                    return out;
-                };
-                into += encode(codepoint);
                 break;
-            }
             default:
                 throw make_error("invalid escape sequence");
             }
@@ -235,8 +529,9 @@ void reader::read_string(std::string& into) {
             escaped = true;
         } else if (current_char == quote) {
             break;
-        } else {
-            into += current_char;
+        } else if (current_char == '\n') {
+            ++line;
+            column = -1;
         }
         advance_char();
     }
@@ -246,88 +541,259 @@ void reader::read_string(std::string& into) {
     advance_char();
 }
 
-token_kind reader::read_number(std::string& into) {
-    into.clear();
+token_kind reader::read_number() {
     bool is_float = false;
     if (is_valid() && peek_char() == '0') {
-        into += get_char();
+        advance_char();
         if (is_valid() && std::isdigit(peek_uchar())) {
             throw make_error("leading zeros not allowed");
         }
     } else if (is_valid() && std::isdigit(peek_uchar())) {
-        do {
-            into += get_char();
-        } while (is_valid() && std::isdigit(peek_uchar()));
+        read_run(scanner::digit_run);
     } else {
         throw make_error("expected digit");
     }
 
     if (is_valid() && peek_char() == '.') {
         is_float = true;
-        into += get_char();
+        advance_char();
         if (!is_valid() || !std::isdigit(peek_uchar())) {
             throw make_error("digit expected after decimal");
         }
-        while (is_valid() && std::isdigit(peek_uchar())) {
-            into += get_char();
-        }
+        read_run(scanner::digit_run);
     }
 
     if (is_valid() && (peek_char() == 'e' || peek_char() == 'E')) {
         is_float = true;
-        into += get_char();
+        advance_char();
         if (is_valid() && (peek_char() == '+' || peek_char() == '-')) {
-            into += get_char();
+            advance_char();
         }
         if (!is_valid() || !std::isdigit(peek_uchar())) {
             throw make_error("digit expected after exponent");
         }
-        while (is_valid() && std::isdigit(peek_uchar())) {
-            into += get_char();
-        }
+        read_run(scanner::digit_run);
     }
     return is_float ? token_kind::floating : token_kind::integer;
 }
 
-void reader::init_token(token& t) const noexcept {
-    t.word.clear();
-    t.pos = get_position();
+/// Sign of the decimal order of magnitude of a well-formed floating literal.
+static bool is_huge(const std::string_view word) noexcept {
+    const size_t exp_at = word.find_first_of("eE");
+    const auto mantissa = word.substr(0, exp_at);
+    const size_t dot = std::min(mantissa.find('.'), mantissa.size());
+    long long magnitude = static_cast<long long>(dot);
+    if (mantissa.front() == '0') {
+        const size_t first = mantissa.find_first_not_of("0.");
+        magnitude = -static_cast<long long>(
+            std::min(first, mantissa.size()) - std::min(dot + 1, first)
+        );
+    }
+    if (exp_at != std::string_view::npos) {
+        auto exponent = word.substr(exp_at + 1);
+        if (exponent.front() == '+') {
+            exponent.remove_prefix(1);
+        }
+        long long value = 0;
+        const auto [ptr, ec] = std::from_chars(
+            exponent.data(), exponent.data() + exponent.size(), value
+        );
+        if (ec == std::errc::result_out_of_range) {
+            return exponent.front() != '-';
+        }
+        magnitude += value;
+    }
+    return magnitude > 0;
+}
+
+static numeric_value
+parse_number(const std::string_view word, const token_kind kind) noexcept {
+    numeric_value result;
+    const char* const first = word.data();
+    const char* const last = word.data() + word.size();
+    if (kind == token_kind::integer) {
+        if (std::from_chars(first, last, result.integer).ec
+            == std::errc::result_out_of_range) {
+            result.integer = std::numeric_limits<uint64_t>::max();
+            result.out_of_range = true;
+        }
+    } else if (std::from_chars(first, last, result.floating).ec
+               == std::errc::result_out_of_range) {
+        result.floating
+            = is_huge(word) ? std::numeric_limits<double>::infinity() : 0.0;
+        result.out_of_range = true;
+    }
+    return result;
+}
+
+numeric_value token::number() const noexcept {
+    return parse_number(word, kind);
+}
+
+struct operator_spelling {
+    std::string_view text;
+    op_kind op;
+};
+
+static constexpr operator_spelling operators[] = {
+    { "=", op_kind::assign },
+    { "+=", op_kind::add_assign },
+    { "-=", op_kind::sub_assign },
+    { "*=", op_kind::mul_assign },
+    { "/=", op_kind::div_assign },
+    { "%=", op_kind::mod_assign },
+    { "^=", op_kind::xor_assign },
+    { "|=", op_kind::or_assign },
+    { "&=", op_kind::and_assign },
+    { "<<=", op_kind::shl_assign },
+    { ">>=", op_kind::shr_assign },
+    { "||", op_kind::logical_or },
+    { "&&", op_kind::logical_and },
+    { "|", op_kind::bit_or },
+    { "^", op_kind::bit_xor },
+    { "&", op_kind::bit_and },
+    { "==", op_kind::equal },
+    { "!=", op_kind::not_equal },
+    { "<", op_kind::less },
+    { "<=", op_kind::less_equal },
+    { ">", op_kind::greater },
+    { ">=", op_kind::greater_equal },
+    { "<<", op_kind::shl },
+    { ">>", op_kind::shr },
+    { "+", op_kind::plus },
+    { "-", op_kind::minus },
+    { "*", op_kind::star },
+    { "/", op_kind::slash },
+    { "%", op_kind::percent },
+    { "!", op_kind::logical_not },
+    { "~", op_kind::bit_not },
+    { "++", op_kind::increment },
+    { "--", op_kind::decrement },
+    { "?", op_kind::question },
+};
+
+static op_kind find_operator(const std::string_view text) noexcept {
+    for (const auto& [spelling, op] : operators) {
+        if (spelling == text) {
+            return op;
+        }
+    }
+    return op_kind::none;
+}
+
+op_kind reader::read_operator() {
+    // every operator's proper prefix is an operator too, so growing the
+    // spelling one character at a time finds the longest match
+    char spelled[3] { peek_char() };
+    size_t length = 1;
+    auto op = find_operator({ spelled, length });
+    advance_char();
+    while (op != op_kind::none && length < sizeof spelled && is_valid()) {
+        spelled[length] = peek_char();
+        const auto longer = find_operator({ spelled, length + 1 });
+        if (longer == op_kind::none) {
+            break;
+        }
+        op = longer;
+        ++length;
+        advance_char();
+    }
+    return op;
 }
 
-std::runtime_error reader::make_error(
+void reader::init_token(token& t) noexcept {
+    t.word = {};
+    t.op = op_kind::none;
+    t.offset = file_offset + static_cast<std::streamoff>(buffer_position);
+    token_start = buffer_position;
+}
+
+void reader::finish_token(token& t) noexcept {
+    t.word = input.substr(token_start, buffer_position - token_start);
+    if (t.kind == token_kind::string) {
+        t.word = t.word.substr(1, t.word.size() - 2);
+    }
+    viewed = true;
+    token_start = std::string_view::npos;
+}
+
+reader_error::reader_error(
+    const std::string& what, std::string message, const position pos
+)
+    : std::runtime_error(what)
+    , message(std::move(message))
+    , pos(pos) { }
+
+reader_error reader::make_error(
     const std::string& message, const std::source_location& location
 ) const {
     std::ostringstream oss;
     oss << "[Reader-Error] " << message << ". ";
 #ifndef NDEBUG
-    if (!ifs.is_open()) {
+    if (!ifs.is_open() && !is_mapped()) {
         oss << "no file open. ";
     }
+    const position here = get_position();
     if (!is_valid()) {
         oss << filename << " is open. ";
-        oss << "position is out of range. line: " << (line + 1)
-            << ", column: " << (column + 1) << " exceeds available input. ";
+        oss << "position is out of range. line: " << (here.line + 1)
+            << ", column: " << (here.column + 1)
+            << " exceeds available input. ";
     } else {
         const char current_char = peek_char();
         oss << "character '" << current_char
             << "' (ASCII: " << static_cast<unsigned>(current_char)
-            << ") was found at line " << (line + 1) << ", column "
-            << (column + 1) << ". ";
+            << ") was found at line " << (here.line + 1) << ", column "
+            << (here.column + 1) << ". ";
     }
     oss << "in file: " << location.file_name() << '(' << location.line() << ':'
         << location.column() << ") `" << location.function_name() << "`";
-    oss << std::endl << buffer;
+    if (is_mapped()) {
+        const auto page = max_buffer_size > 0
+            ? static_cast<size_t>(max_buffer_size)
+            : input.size();
+        const size_t from
+            = std::min(buffer_position - buffer_position % page, input.size());
+        oss << std::endl << input.substr(from, page);
+    } else {
+        oss << std::endl << input;
+    }
 #endif
-    return std::runtime_error(oss.str());
+    return { oss.str(), message, get_position() };
 }
 
 void reader::next_token(token& out) {
+    if (sink == nullptr) {
+        read_token(out);
+        return;
+    }
+    const position at = get_position();
+    try {
+        read_token(out);
+    } catch (const reader_error& e) {
+        recover(out, at, e);
+    }
+}
+
+void reader::recover(token& out, const position at, const reader_error& error) {
+    sink->push_back({ at, error.message });
+    jump_to_position(at);
+    init_token(out);
+    out.kind = token_kind::error;
+    do {
+        advance_char();
+    } while (is_valid() && peek_char() != ';' && peek_char() != '}'
+             && peek_char() != '\n');
+    finish_token(out);
+}
+
+void reader::read_token(token& out) {
     init_token(out);
     out.kind = token_kind::special_character;
 
     if (!is_valid()) {
         out.kind = token_kind::eof;
-        out.word.clear();
+        token_start = std::string_view::npos;
         return;
     }
     switch (const char current_char = peek_char()) {
@@ -335,42 +801,88 @@ void reader::next_token(token& out) {
     case '[':
     case '{':
         out.kind = token_kind::open_bracket;
-        out.word = std::string(1, get_char());
+        advance_char();
         break;
     case ')':
     case ']':
     case '}':
         out.kind = token_kind::close_bracket;
-        out.word = std::string(1, get_char());
+        advance_char();
         break;
     case ',':
     case ';':
+        out.kind = token_kind::separator;
+        advance_char();
+        break;
     case ':':
         out.kind = token_kind::separator;
-        out.word = std::string(1, get_char());
+        out.op = op_kind::colon;
+        advance_char();
         break;
     case '/':
-        out.word = std::string(1, get_char());
+        advance_char();
         if (is_valid() && (peek_char() == '/' || peek_char() == '*')) {
-            read_comment(out.word);
+            read_comment();
             out.kind = token_kind::comment;
+        } else if (is_valid() && peek_char() == '=') {
+            advance_char();
+            out.op = op_kind::div_assign;
+        } else {
+            out.op = op_kind::slash;
         }
         break;
     default:
         if (std::isalpha(static_cast<unsigned char>(current_char))
             || current_char == '_') {
-            read_keyword(out.word);
+            read_keyword();
             out.kind = token_kind::keyword;
         } else if (std::isdigit(static_cast<unsigned char>(current_char))) {
-            out.kind = read_number(out.word);
+            out.kind = read_number();
         } else if (current_char == '"' || current_char == '\'') {
-            read_string(out.word);
+            read_string();
             out.kind = token_kind::string;
         } else if (std::isspace(static_cast<unsigned char>(current_char))) {
-            read_whitespace(out.word);
+            read_whitespace();
             out.kind = token_kind::whitespace;
         } else {
-            out.word = std::string(1, get_char());
+            out.op = read_operator();
+        }
+    }
+    finish_token(out);
+}
+
+void reader::skip_trivia() {
+    while (is_valid()) {
+        if (std::isspace(peek_uchar())) {
+            read_whitespace();
+            continue;
+        }
+        if (peek_char() != '/') {
+            return;
+        }
+        const position start = sink != nullptr ? get_position() : position {};
+        // keep the slash addressable in case it turns out to be an operator
+        token_start = buffer_position;
+        advance_char();
+        const bool is_comment
+            = is_valid() && (peek_char() == '/' || peek_char() == '*');
+        if (!is_comment) {
+            buffer_position = token_start;
+            --column;
+            token_start = std::string_view::npos;
+            return;
+        }
+        token_start = std::string_view::npos;
+        if (sink == nullptr) {
+            read_comment();
+            continue;
+        }
+        try {
+            read_comment();
+        } catch (const reader_error&) {
+            // left to next_token(), which reports it as an error token
+            jump_to_position(start);
+            return;
         }
     }
 }
@@ -380,27 +892,35 @@ void reader::jump_to_position(const position pos) {
         throw make_error("position is out of range");
     }
     if (!ifs.is_open()) {
-        buffer_position = static_cast<size_t>(pos.offset);
-        if (buffer_position > buffer.size()) {
+        if (static_cast<size_t>(pos.offset) > input.size()) {
             throw make_error("position is out of range");
         }
+        buffer_position = static_cast<size_t>(pos.offset);
     } else {
         ifs.clear();
         ifs.seekg(pos.offset, std::ios::beg);
+        token_start = std::string_view::npos;
         reload_buffer();
     }
     this->line = pos.line;
     this->column = pos.column;
+    if (index) {
+        this->line = get_position().line;
+    }
 }
 
 void reader::interrupt() {
-    if (ifs.is_open() && ifs.eof()) {
+    if ((ifs.is_open() && ifs.eof()) || (is_mapped() && !is_valid())) {
         return;
     }
     throw make_error("interrupted");
 }
 
 position reader::get_position() const {
-    return { file_offset + static_cast<std::streamoff>(buffer_position), line,
-             column };
+    const auto offset
+        = file_offset + static_cast<std::streamoff>(buffer_position);
+    if (index) {
+        return index->locate(offset, line);
+    }
+    return { offset, line, column };
 }
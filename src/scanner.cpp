@@ -0,0 +1,407 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "scanner.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define QPILER_HAS_X86_KERNELS 1
+#endif
+
+enum class char_class { whitespace, identifier, digit };
+
+template <char_class C>
+static bool matches(const unsigned char c) noexcept {
+    if constexpr (C == char_class::whitespace) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    } else if constexpr (C == char_class::digit) {
+        return c >= '0' && c <= '9';
+    } else {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+            || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+}
+
+template <char_class C>
+static size_t run_scalar(const std::string_view text) noexcept {
+    size_t i = 0;
+    while (i < text.size()
+           && matches<C>(static_cast<unsigned char>(text[i]))) {
+        ++i;
+    }
+    return i;
+}
+
+static size_t newlines_scalar(const std::string_view text) noexcept {
+    size_t count = 0;
+    for (const char c : text) {
+        count += c == '\n' ? 1 : 0;
+    }
+    return count;
+}
+
+static void starts_scalar(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') {
+            into.push_back(base + i + 1);
+        }
+    }
+}
+
+static bool is_structural(const char c) noexcept {
+    switch (c) {
+    case '(':
+    case ')':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '"':
+    case '\'':
+    case '/':
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void structural_scalar(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (is_structural(text[i])) {
+            into.push_back(base + i);
+        }
+    }
+}
+
+/// Append @p base plus the index of every set bit of @p mask to @p into.
+static void
+push_bits(std::uint32_t mask, const size_t base, std::vector<size_t>& into) {
+    while (mask != 0) {
+        into.push_back(base + static_cast<size_t>(std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+#ifdef QPILER_HAS_X86_KERNELS
+
+// signed compares are fine: bytes >= 0x80 are negative and never in range
+static __m128i
+in_range(const __m128i v, const char lo, const char hi) noexcept {
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+        _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1)))
+    );
+}
+
+template <char_class C>
+static __m128i classify(const __m128i v) noexcept {
+    if constexpr (C == char_class::whitespace) {
+        return _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range(v, '\t', '\r')
+        );
+    } else if constexpr (C == char_class::digit) {
+        return in_range(v, '0', '9');
+    } else {
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        return _mm_or_si128(
+            _mm_or_si128(in_range(v, '0', '9'), in_range(lower, 'a', 'z')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))
+        );
+    }
+}
+
+template <char_class C>
+static size_t run_sse2(const std::string_view text) noexcept {
+    size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(text.data() + i)
+        );
+        const auto mask
+            = static_cast<std::uint32_t>(_mm_movemask_epi8(classify<C>(v)));
+        if (mask != 0xFFFF) {
+            return i + static_cast<size_t>(std::countr_one(mask));
+        }
+    }
+    return i + run_scalar<C>(text.substr(i));
+}
+
+static size_t newlines_sse2(const std::string_view text) noexcept {
+    size_t count = 0;
+    size_t i = 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= text.size(); i += 16) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(text.data() + i)
+        );
+        count += static_cast<size_t>(std::popcount(
+            static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)))
+        ));
+    }
+    return count + newlines_scalar(text.substr(i));
+}
+
+static void starts_sse2(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    size_t i = 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= text.size(); i += 16) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(text.data() + i)
+        );
+        const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        push_bits(static_cast<std::uint32_t>(mask), base + i + 1, into);
+    }
+    starts_scalar(text.substr(i), into, base + i);
+}
+
+static __m128i structural_mask(const __m128i v) noexcept {
+    // brackets, quotes and '/' are all below 0x80
+    __m128i hit = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+    for (const char c : { '(', ')', '[', ']', '{', '}', '"', '\'' }) {
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    }
+    return hit;
+}
+
+static void structural_sse2(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(text.data() + i)
+        );
+        const auto mask = _mm_movemask_epi8(structural_mask(v));
+        push_bits(static_cast<std::uint32_t>(mask), base + i, into);
+    }
+    structural_scalar(text.substr(i), into, base + i);
+}
+
+[[gnu::target("avx2")]] static __m256i
+in_range_avx2(const __m256i v, const char lo, const char hi) noexcept {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v)
+    );
+}
+
+template <char_class C>
+[[gnu::target("avx2")]] static __m256i
+classify_avx2(const __m256i v) noexcept {
+    if constexpr (C == char_class::whitespace) {
+        return _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+            in_range_avx2(v, '\t', '\r')
+        );
+    } else if constexpr (C == char_class::digit) {
+        return in_range_avx2(v, '0', '9');
+    } else {
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        return _mm256_or_si256(
+            _mm256_or_si256(
+                in_range_avx2(v, '0', '9'), in_range_avx2(lower, 'a', 'z')
+            ),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'))
+        );
+    }
+}
+
+template <char_class C>
+[[gnu::target("avx2")]] static size_t
+run_avx2(const std::string_view text) noexcept {
+    size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(text.data() + i)
+        );
+        const auto mask = static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(classify_avx2<C>(v))
+        );
+        if (mask != 0xFFFFFFFF) {
+            return i + static_cast<size_t>(std::countr_one(mask));
+        }
+    }
+    return i + run_sse2<C>(text.substr(i));
+}
+
+[[gnu::target("avx2")]] static size_t
+newlines_avx2(const std::string_view text) noexcept {
+    size_t count = 0;
+    size_t i = 0;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; i + 32 <= text.size(); i += 32) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(text.data() + i)
+        );
+        count += static_cast<size_t>(std::popcount(static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl))
+        )));
+    }
+    return count + newlines_sse2(text.substr(i));
+}
+
+[[gnu::target("avx2")]] static void starts_avx2(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    size_t i = 0;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; i + 32 <= text.size(); i += 32) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(text.data() + i)
+        );
+        const auto mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        push_bits(static_cast<std::uint32_t>(mask), base + i + 1, into);
+    }
+    starts_sse2(text.substr(i), into, base + i);
+}
+
+[[gnu::target("avx2")]] static void structural_avx2(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(text.data() + i)
+        );
+        __m256i hit = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+        for (const char c : { '(', ')', '[', ']', '{', '}', '"', '\'' }) {
+            hit = _mm256_or_si256(
+                hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+            );
+        }
+        const auto mask = _mm256_movemask_epi8(hit);
+        push_bits(static_cast<std::uint32_t>(mask), base + i, into);
+    }
+    structural_sse2(text.substr(i), into, base + i);
+}
+
+#endif
+
+struct kernel_table {
+    scan_kernel kind;
+    size_t (*whitespace)(std::string_view) noexcept;
+    size_t (*identifier)(std::string_view) noexcept;
+    size_t (*digit)(std::string_view) noexcept;
+    size_t (*newlines)(std::string_view) noexcept;
+    void (*starts)(std::string_view, std::vector<size_t>&, size_t);
+    void (*structural)(std::string_view, std::vector<size_t>&, size_t);
+};
+
+static constexpr kernel_table scalar_table {
+    scan_kernel::scalar, run_scalar<char_class::whitespace>,
+    run_scalar<char_class::identifier>, run_scalar<char_class::digit>,
+    newlines_scalar, starts_scalar, structural_scalar
+};
+
+#ifdef QPILER_HAS_X86_KERNELS
+static constexpr kernel_table sse2_table {
+    scan_kernel::sse2, run_sse2<char_class::whitespace>,
+    run_sse2<char_class::identifier>, run_sse2<char_class::digit>,
+    newlines_sse2, starts_sse2, structural_sse2
+};
+
+static constexpr kernel_table avx2_table {
+    scan_kernel::avx2, run_avx2<char_class::whitespace>,
+    run_avx2<char_class::identifier>, run_avx2<char_class::digit>,
+    newlines_avx2, starts_avx2, structural_avx2
+};
+#endif
+
+static const kernel_table* find_table(const scan_kernel kernel) noexcept {
+    switch (kernel) {
+#ifdef QPILER_HAS_X86_KERNELS
+    case scan_kernel::avx2:
+        return __builtin_cpu_supports("avx2") ? &avx2_table : nullptr;
+    case scan_kernel::sse2:
+        return &sse2_table;
+#endif
+    case scan_kernel::scalar:
+        return &scalar_table;
+    default:
+        return nullptr;
+    }
+}
+
+static const kernel_table* best_table() noexcept {
+    for (const auto kernel : { scan_kernel::avx2, scan_kernel::sse2 }) {
+        if (const auto* table = find_table(kernel)) {
+            return table;
+        }
+    }
+    return &scalar_table;
+}
+
+static std::atomic<const kernel_table*> active { best_table() };
+
+size_t scanner::whitespace_run(const std::string_view text) noexcept {
+    return active.load(std::memory_order_relaxed)->whitespace(text);
+}
+
+size_t scanner::identifier_run(const std::string_view text) noexcept {
+    return active.load(std::memory_order_relaxed)->identifier(text);
+}
+
+size_t scanner::digit_run(const std::string_view text) noexcept {
+    return active.load(std::memory_order_relaxed)->digit(text);
+}
+
+size_t scanner::count_newlines(const std::string_view text) noexcept {
+    return active.load(std::memory_order_relaxed)->newlines(text);
+}
+
+void scanner::line_starts(
+    const std::string_view text, std::vector<size_t>& into, const size_t base
+) {
+    active.load(std::memory_order_relaxed)->starts(text, into, base);
+}
+
+void scanner::structural(
+    const std::string_view text, std::vector<size_t>& into
+) {
+    active.load(std::memory_order_relaxed)->structural(text, into, 0);
+}
+
+scan_kernel scanner::active_kernel() noexcept {
+    return active.load(std::memory_order_relaxed)->kind;
+}
+
+bool scanner::use_kernel(const scan_kernel kernel) noexcept {
+    const auto* table = find_table(kernel);
+    if (table == nullptr) {
+        return false;
+    }
+    active.store(table, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,89 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "spill_store.hpp"
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+spill_store::spill_store()
+    : file(std::tmpfile(), &std::fclose) {
+    if (!file) {
+        throw std::runtime_error(
+            "[SpillStore-Error] cannot create a temporary file"
+        );
+    }
+}
+
+std::optional<flat_tree>
+spill_store::load(const subtree_key& key, interner& symbols) {
+    const auto it = records.find(key);
+    if (it == records.end()) {
+        return std::nullopt;
+    }
+    std::string bytes(it->second.length, '\0');
+    if (std::fseek(file.get(), it->second.offset, SEEK_SET) != 0
+        || std::fread(bytes.data(), 1, bytes.size(), file.get())
+            != bytes.size()) {
+        throw std::runtime_error(
+            "[SpillStore-Error] cannot read a spilled subtree"
+        );
+    }
+    std::istringstream is { std::move(bytes) };
+    auto tree = flat_tree::deserialize(is, symbols);
+    ++reload_count;
+    return tree;
+}
+
+void spill_store::store(const subtree_key& key, const flat_tree& tree) {
+    std::ostringstream os;
+    tree.serialize(os);
+    const std::string bytes = std::move(os).str();
+    if (bytes.size() > static_cast<size_t>(std::numeric_limits<long>::max())
+            - static_cast<size_t>(tail)
+        || std::fseek(file.get(), tail, SEEK_SET) != 0
+        || std::fwrite(bytes.data(), 1, bytes.size(), file.get())
+            != bytes.size()) {
+        throw std::runtime_error(
+            "[SpillStore-Error] cannot write a spilled subtree"
+        );
+    }
+    records[key] = { tail, bytes.size() };
+    tail += static_cast<long>(bytes.size());
+}
+
+void spill_store::clear() noexcept {
+    records.clear();
+    tail = 0;
+}
+
+size_t spill_store::size() const noexcept { return records.size(); }
+
+size_t spill_store::bytes() const noexcept {
+    return static_cast<size_t>(tail);
+}
+
+size_t spill_store::reloads() const noexcept { return reload_count; }
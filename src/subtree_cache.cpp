@@ -0,0 +1,77 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "subtree_cache.hpp"
+
+subtree_cache::subtree_cache(const size_t budget)
+    : capacity(budget) { }
+
+ast_root subtree_cache::find(const subtree_key& key) {
+    const auto it = index.find(key);
+    if (it == index.end()) {
+        ++miss_count;
+        return nullptr;
+    }
+    ++hit_count;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->root;
+}
+
+void subtree_cache::insert(
+    const subtree_key& key, ast_root root, const size_t bytes
+) {
+    if (const auto it = index.find(key); it != index.end()) {
+        used -= it->second->bytes;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    if (bytes > capacity) {
+        return;
+    }
+    while (used + bytes > capacity) {
+        used -= entries.back().bytes;
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({ key, std::move(root), bytes });
+    index.emplace(key, entries.begin());
+    used += bytes;
+}
+
+void subtree_cache::clear() noexcept {
+    index.clear();
+    entries.clear();
+    used = 0;
+}
+
+size_t subtree_cache::hits() const noexcept { return hit_count; }
+
+size_t subtree_cache::misses() const noexcept { return miss_count; }
+
+size_t subtree_cache::size() const noexcept { return entries.size(); }
+
+size_t subtree_cache::bytes() const noexcept { return used; }
+
+size_t subtree_cache::budget() const noexcept { return capacity; }
@@ -94,41 +94,75 @@ TEST(ArithmeticTest, ParseNestedGroups) {
     EXPECT_FALSE(post->is_prefix);
 }
 
+TEST(ArithmeticTest, PrecedenceLevels) {
+    // every operator binds tighter than the one before it
+    std::string input = "v = a || b && c | d ^ e & f == g < h << i + j * k";
+    reader r { input };
+    grouper g { r };
+    auto res = g.parse();
+    auto cmd = node_cast<group_node>(res->nodes[0]);
+    ASSERT_TRUE(cmd);
+    ast_node_ptr node = cmd->nodes[0];
+    int priority = 0;
+    for (const std::string_view op :
+         { "=", "||", "&&", "|", "^", "&", "==", "<", "<<", "+", "*" }) {
+        const auto bin = node_cast<binary_node>(node);
+        ASSERT_TRUE(bin) << op;
+        EXPECT_EQ(bin->op.word, op);
+        EXPECT_GT(bin->priority, priority);
+        priority = bin->priority;
+        node = bin->rhs;
+    }
+    EXPECT_TRUE(node_cast<token_node>(node));
+}
+
 TEST(ExpressionTest, TernaryBranches) {
+    ast_arena arena;
     std::vector<ast_node_ptr> nodes;
-    auto make_tok = [&](std::string w, const token_kind k) {
-        auto t = std::make_shared<token_node>();
-        t->value.word = std::move(w);
+    auto make_tok = [&](const std::string_view w, const token_kind k,
+                        const op_kind op = op_kind::none) {
+        auto t = arena.make<token_node>();
+        t->value.word = w;
         t->value.kind = k;
+        t->value.op = op;
         return t;
     };
     nodes.push_back(make_tok("a", token_kind::keyword));
-    nodes.push_back(make_tok("?", token_kind::special_character));
+    nodes.push_back(make_tok(
+        "?", token_kind::special_character, op_kind::question
+    ));
     nodes.push_back(make_tok("b", token_kind::keyword));
-    nodes.push_back(make_tok(":", token_kind::separator));
+    nodes.push_back(make_tok(":", token_kind::separator, op_kind::colon));
     nodes.push_back(make_tok("c", token_kind::keyword));
-    auto items = expression::make_items(nodes);
+    expression::scratch work;
+    const size_t before = arena.size();
     size_t idx = 0;
-    auto n = expression::parse_expression(items, idx, 0);
-    ASSERT_TRUE(std::dynamic_pointer_cast<ternary_node>(n));
-    EXPECT_EQ(idx, items.size());
+    auto n = expression::parse_expression(nodes, idx, 0, arena, work);
+    ASSERT_TRUE(node_cast<ternary_node>(n));
+    EXPECT_EQ(idx, nodes.size());
+    // the operands are linked in place, only the ternary is new
+    EXPECT_EQ(arena.size(), before + 1);
 
     idx = 0;
-    n = expression::parse_expression(items, idx, 3);
-    auto tok = std::dynamic_pointer_cast<token_node>(n);
+    n = expression::parse_expression(nodes, idx, 3, arena, work);
+    auto tok = node_cast<token_node>(n);
     ASSERT_TRUE(tok);
     EXPECT_EQ(tok->value.word, "a");
     EXPECT_EQ(idx, 1u);
 
-    items.pop_back();
+    nodes.pop_back();
     idx = 0;
     EXPECT_THROW(
-        expression::parse_expression(items, idx, 0), std::runtime_error
+        expression::parse_expression(nodes, idx, 0, arena, work),
+        std::runtime_error
     );
 }
 
 TEST(ExpressionTest, ParsePrefixUnexpectedEnd) {
-    std::vector<expression::item> items;
+    ast_arena arena;
+    expression::scratch work;
     size_t idx = 0;
-    EXPECT_THROW(expression::parse_prefix(items, idx), std::runtime_error);
+    EXPECT_THROW(
+        expression::parse_prefix({}, idx, arena, work), std::runtime_error
+    );
 }
@@ -39,7 +39,7 @@ TEST(AstDump, ExamplePartAST) {
             std::ostringstream path_out;
             path_out << "test_data/test" << idx.str() << ".dump";
             std::ofstream out(path_out.str());
-            res->dump(out, "", true, false);
+            res->dump(out, r.lines(), "", true, false);
         } catch (const std::runtime_error& e) {
             std::cout << "Error processing test case " << i << ": \n"
                       << e.what() << "\n\n";
@@ -61,10 +61,76 @@ TEST(AstDump, ExampleFullAST) {
             std::ostringstream path_out;
             path_out << "test_data/test" << idx.str() << ".full-dump";
             std::ofstream out(path_out.str());
-            res->dump(out, "", true, true);
+            res->dump(out, r.lines(), "", true, true);
         } catch (const std::runtime_error& e) {
             std::cout << "Error processing test case " << i << ": \n"
                       << e.what() << "\n\n";
         }
     }
 }
+
+template <typename T> static bool is_rtti(const ast_node* node) {
+    return dynamic_cast<const T*>(node) != nullptr;
+}
+
+TEST(AstNodeKind, TagsAgreeWithRtti) {
+    reader r { "test_data/test12.qc" };
+    grouper g { r, 128 };
+    const auto res = g.parse();
+    std::vector<const ast_node*> pending { res.get() };
+    size_t visited = 0;
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        ++visited;
+        EXPECT_EQ(isa<token_node>(node), is_rtti<token_node>(node));
+        EXPECT_EQ(isa<callexp_node>(node), is_rtti<callexp_node>(node));
+        EXPECT_EQ(isa<fundecl_node>(node), is_rtti<fundecl_node>(node));
+        EXPECT_EQ(isa<control_node>(node), is_rtti<control_node>(node));
+        EXPECT_EQ(isa<condition_node>(node), is_rtti<condition_node>(node));
+        EXPECT_EQ(isa<jump_node>(node), is_rtti<jump_node>(node));
+        EXPECT_EQ(isa<group_node>(node), is_rtti<group_node>(node));
+        EXPECT_EQ(isa<wrapped_node>(node), is_rtti<wrapped_node>(node));
+        EXPECT_EQ(
+            isa<placeholder_node>(node), is_rtti<placeholder_node>(node)
+        );
+        EXPECT_EQ(isa<unary_node>(node), is_rtti<unary_node>(node));
+        EXPECT_EQ(isa<binary_node>(node), is_rtti<binary_node>(node));
+        EXPECT_EQ(isa<ternary_node>(node), is_rtti<ternary_node>(node));
+        const bool dispatched = visit_node(*node, []<typename N>(const N& n) {
+            return typeid(n) == typeid(N);
+        });
+        EXPECT_TRUE(dispatched);
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+    }
+    EXPECT_GT(visited, 100u);
+}
+
+TEST(AstArena, SqueezeReleasesSubtree) {
+    std::string text = "a b c d e f g h";
+    reader r { text };
+    const squeeze_context context { &r };
+    ast_arena arena;
+    auto outer = arena.make<group_node>();
+    outer->limit = 64;
+    auto inner = arena.make<group_node>();
+    inner->limit = 64;
+    token current;
+    for (r.skip_trivia(), r.next_token(current);
+         current.kind != token_kind::eof;
+         r.skip_trivia(), r.next_token(current)) {
+        inner->append(arena.make<token_node>(current), context, arena);
+    }
+    ASSERT_EQ(inner->size(), 8u);
+    outer->append(inner, context, arena);
+    const size_t bytes = arena.used();
+    const size_t nodes = arena.size();
+    EXPECT_EQ(nodes, 10u);
+    outer->squeeze(0, context, arena);
+    ASSERT_TRUE(isa<placeholder_node>(outer->nodes[0]));
+    // the group and its eight tokens make way for one placeholder
+    EXPECT_EQ(arena.size(), nodes - 8);
+    EXPECT_LT(arena.used(), bytes);
+}
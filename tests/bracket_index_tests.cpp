@@ -0,0 +1,95 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "bracket_index.hpp"
+#include "lexer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+TEST(BracketIndexTest, MatchesNestedPairs) {
+    const std::string_view text = "f(a[1]) { g({x}); }";
+    const bracket_index index { text };
+    EXPECT_TRUE(index.balanced());
+    ASSERT_EQ(index.pairs().size(), 5u);
+    EXPECT_EQ(index.close_of(1), 6u);
+    EXPECT_EQ(index.close_of(3), 5u);
+    EXPECT_EQ(index.close_of(8), 18u);
+    EXPECT_EQ(index.close_of(11), 15u);
+    EXPECT_EQ(index.close_of(12), 14u);
+    EXPECT_FALSE(index.close_of(0).has_value());
+}
+
+TEST(BracketIndexTest, SkipsStringsAndComments) {
+    const std::string_view text
+        = "a(\"(\", ')', \"\\\"[\") // (\n/* { */ b[0] /*/ ] */";
+    const bracket_index index { text };
+    EXPECT_TRUE(index.balanced());
+    ASSERT_EQ(index.pairs().size(), 2u);
+    EXPECT_EQ(text[index.pairs()[0].open], '(');
+    EXPECT_EQ(text[index.pairs()[0].close], ')');
+    EXPECT_EQ(index.pairs()[0].close, text.find(") //"));
+    EXPECT_EQ(text[index.pairs()[1].open], '[');
+    EXPECT_EQ(index.pairs()[1].close, text.find("] /*/"));
+}
+
+TEST(BracketIndexTest, ReportsFirstUnbalanced) {
+    EXPECT_EQ(bracket_index { "(]" }.unbalanced(), 1u);
+    EXPECT_EQ(bracket_index { "a) (" }.unbalanced(), 1u);
+    EXPECT_EQ(bracket_index { "{ ( }" }.unbalanced(), 4u);
+    EXPECT_EQ(bracket_index { "{ ( ) [" }.unbalanced(), 6u);
+    const bracket_index index { "[x] { (y" };
+    EXPECT_FALSE(index.balanced());
+    EXPECT_EQ(index.unbalanced(), 6u);
+    ASSERT_EQ(index.pairs().size(), 1u);
+    EXPECT_EQ(index.close_of(0), 2u);
+}
+
+TEST(BracketIndexTest, AgreesWithLexer) {
+    for (const auto& entry : std::filesystem::directory_iterator("test_data")) {
+        reader r { entry.path() };
+        std::vector<bracket_pair> expected;
+        std::vector<size_t> open;
+        for (const auto& t : lexer::tokenize(r)) {
+            const auto offset = static_cast<size_t>(t.offset);
+            if (t.kind == token_kind::open_bracket) {
+                open.push_back(expected.size());
+                expected.push_back({ offset, 0 });
+            } else if (t.kind == token_kind::close_bracket) {
+                ASSERT_FALSE(open.empty());
+                expected[open.back()].close = offset;
+                open.pop_back();
+            }
+        }
+        const bracket_index index { r.source() };
+        EXPECT_TRUE(index.balanced()) << entry.path();
+        ASSERT_EQ(index.pairs().size(), expected.size()) << entry.path();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(index.pairs()[i].open, expected[i].open);
+            EXPECT_EQ(index.pairs()[i].close, expected[i].close);
+        }
+    }
+}
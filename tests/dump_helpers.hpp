@@ -0,0 +1,55 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef DUMP_HELPERS_HPP
+#define DUMP_HELPERS_HPP
+
+#include "ast.hpp"
+
+#include <sstream>
+#include <string>
+
+/// Dump of the tree below @p node, see ast_node::dump().
+inline std::string
+dumped(const ast_node& node, const line_index& lines, const bool full) {
+    std::ostringstream os;
+    node.dump(os, lines, "", true, full);
+    return os.str();
+}
+
+/// Token lines of a full dump; expansion may wrap subtrees in extra groups.
+inline std::string
+dumped_tokens(const ast_node& node, const line_index& lines) {
+    std::istringstream dump { dumped(node, lines, true) };
+    std::string tokens;
+    for (std::string line; std::getline(dump, line);) {
+        if (const auto at = line.find("Token("); at != std::string::npos) {
+            tokens += line.substr(at) + "\n";
+        }
+    }
+    return tokens;
+}
+
+#endif // DUMP_HELPERS_HPP
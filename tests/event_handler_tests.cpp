@@ -0,0 +1,114 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+/// Writes one line per event.
+class recorder final : public event_handler {
+public:
+    std::ostringstream log;
+
+    void enter_group(const group_kind kind, const position& start) override {
+        log << "enter " << group_kind_name(kind) << " " << start.line << ":"
+            << start.column << "\n";
+    }
+    void leave_group(const group_kind kind, const position&) override {
+        log << "leave " << group_kind_name(kind) << "\n";
+    }
+    void separator(const group_kind kind, const token&) override {
+        log << "end " << group_kind_name(kind) << "\n";
+    }
+    void call(const token& name) override {
+        log << "call " << name.word << "\n";
+    }
+    void control(const token& keyword) override {
+        log << "control " << keyword.word << "\n";
+    }
+    void op(const token& tok) override { log << "op " << tok.word << "\n"; }
+    void value(const token& tok) override {
+        log << "value " << tok.word << "\n";
+    }
+};
+
+TEST(EventHandlerTest, ReportsStructureInSourceOrder) {
+    std::string input = "f(a, 1) {\n  if (a) { return -a; }\n}\nx = [b];";
+    reader r { input };
+    grouper g { r };
+    recorder events;
+    g.parse(events);
+    EXPECT_EQ(
+        events.log.str(),
+        "enter file 0:0\ncall f\nenter paren 0:1\nvalue a\nend item\n"
+        "value 1\nleave paren\nenter body 0:8\ncontrol if\nenter paren 1:5\n"
+        "value a\nleave paren\nenter body 1:9\ncontrol return\nop -\n"
+        "value a\nend command\nleave body\nleave body\nvalue x\nop =\n"
+        "enter list 3:4\nvalue b\nleave list\nend command\nleave file\n"
+    );
+}
+
+/// Tracks the nesting depth only.
+class depth_counter final : public event_handler {
+public:
+    size_t depth { 0 };
+    size_t max_depth { 0 };
+
+    void enter_group(group_kind, const position&) override {
+        max_depth = std::max(max_depth, ++depth);
+    }
+    void leave_group(group_kind, const position&) override { --depth; }
+};
+
+TEST(EventHandlerTest, HandlesDeepNesting) {
+    constexpr size_t depth = 100000;
+    std::string input;
+    for (size_t i = 0; i < depth; ++i) {
+        input += "{[(";
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        input += ")]}";
+    }
+    reader r { input };
+    grouper g { r };
+    depth_counter events;
+    g.parse(events);
+    EXPECT_EQ(events.depth, 0u);
+    EXPECT_EQ(events.max_depth, 3 * depth + 1);
+}
+
+TEST(EventHandlerTest, MismatchedBracketsThrow) {
+    std::string input = "f(a, {b) }";
+    reader r { input };
+    grouper g { r };
+    event_handler ignore;
+    EXPECT_THROW(g.parse(ignore), std::runtime_error);
+    std::string open = "{ a;";
+    reader unclosed { open };
+    grouper g2 { unclosed };
+    EXPECT_THROW(g2.parse(ignore), std::runtime_error);
+}
@@ -0,0 +1,203 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "dump_helpers.hpp"
+#include "grouper.hpp"
+#include "interner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+
+static std::string flat_dump(
+    const flat_tree& tree, const line_index& lines, const bool full
+) {
+    std::ostringstream os;
+    tree.dump(os, lines, full);
+    return os.str();
+}
+
+TEST(FlatTreeTest, DumpMatchesTree) {
+    for (int i = 0; i < 13; ++i) {
+        std::ostringstream path;
+        path << "test_data/test" << std::setfill('0') << std::setw(2) << i
+             << ".qc";
+        for (const size_t limit : { 64u, 1u << 20 }) {
+            reader r { path.str() };
+            grouper g { r, limit };
+            ast_root root;
+            try {
+                root = g.parse();
+            } catch (const std::runtime_error&) {
+                continue;
+            }
+            const flat_tree tree { *root };
+            const auto& lines = r.lines();
+            EXPECT_EQ(
+                flat_dump(tree, lines, false), dumped(*root, lines, false)
+            ) << path.str();
+            if (limit > 64) {
+                // without placeholders the full dump needs no reparse
+                EXPECT_EQ(
+                    flat_dump(tree, lines, true), dumped(*root, lines, true)
+                ) << path.str();
+            }
+        }
+    }
+}
+
+TEST(FlatTreeTest, LinksFollowPreOrder) {
+    std::string source = "x = a + b * -c;\nf(a, b) { return a; }";
+    reader r { source };
+    grouper g { r };
+    const flat_tree tree = g.parse_flat();
+    ASSERT_GT(tree.size(), 1u);
+    EXPECT_EQ(tree.kind(0), node_kind::group);
+    EXPECT_EQ(tree.group(0), group_kind::file);
+    EXPECT_EQ(tree.next_sibling(0), flat_tree::none);
+    std::string operators;
+    for (uint32_t i = 0; i < tree.size(); ++i) {
+        for (uint32_t child = tree.first_child(i); child != flat_tree::none;
+             child = tree.next_sibling(child)) {
+            EXPECT_GT(child, i);
+        }
+        if (tree.kind(i) == node_kind::binary
+            || tree.kind(i) == node_kind::unary) {
+            ASSERT_NE(tree.value(i), nullptr);
+            operators += tree.value(i)->word;
+        }
+        if (tree.kind(i) == node_kind::group) {
+            EXPECT_EQ(tree.value(i), nullptr);
+        }
+    }
+    EXPECT_EQ(operators, "=+*-");
+}
+
+TEST(FlatTreeTest, SerializationRoundTrip) {
+    std::string source = "while (i < 10) { s += \"a\\tb\"; i++; }\n"
+                         "if (s) { print(s, 1.5e3); } else { goto end; }";
+    reader r { source };
+    grouper g { r };
+    const flat_tree tree = g.parse_flat();
+    std::stringstream buffer;
+    tree.serialize(buffer);
+    flat_tree copy = flat_tree::deserialize(buffer, *r.symbols());
+    const flat_tree moved = std::move(copy);
+    ASSERT_EQ(moved.size(), tree.size());
+    const auto& lines = r.lines();
+    EXPECT_EQ(flat_dump(moved, lines, false), flat_dump(tree, lines, false));
+    EXPECT_EQ(flat_dump(moved, lines, true), flat_dump(tree, lines, true));
+    for (uint32_t i = 0; i < tree.size(); ++i) {
+        EXPECT_EQ(moved.kind(i), tree.kind(i));
+        EXPECT_EQ(moved.first_child(i), tree.first_child(i));
+        EXPECT_EQ(moved.next_sibling(i), tree.next_sibling(i));
+        if (tree.value(i) != nullptr) {
+            EXPECT_EQ(moved.symbol(i), tree.symbol(i));
+            if (tree.kind(i) == node_kind::condition) {
+                EXPECT_NE(tree.symbol(i), 0u);
+            }
+            EXPECT_EQ(moved.value(i)->op, tree.value(i)->op);
+            EXPECT_EQ(moved.value(i)->text(), tree.value(i)->text());
+        }
+    }
+}
+
+TEST(FlatTreeTest, RejectsMalformedInput) {
+    interner symbols;
+    std::stringstream empty;
+    EXPECT_THROW(
+        flat_tree::deserialize(empty, symbols), std::runtime_error
+    );
+    std::string source = "a = b;";
+    reader r { source };
+    grouper g { r };
+    std::stringstream buffer;
+    g.parse_flat().serialize(buffer);
+    std::string bytes = buffer.str();
+    std::stringstream truncated { bytes.substr(0, bytes.size() - 1) };
+    EXPECT_THROW(
+        flat_tree::deserialize(truncated, symbols), std::runtime_error
+    );
+    bytes[0] = 'X';
+    std::stringstream corrupted { bytes };
+    EXPECT_THROW(
+        flat_tree::deserialize(corrupted, symbols), std::runtime_error
+    );
+}
+
+TEST(FlatTreeTest, RejectsEveryTruncation) {
+    std::string source = "f(a) { x = -a ? 1 : 'two'; }";
+    reader r { source };
+    grouper g { r };
+    std::stringstream buffer;
+    g.parse_flat().serialize(buffer);
+    const std::string bytes = buffer.str();
+    for (size_t length = 0; length < bytes.size(); ++length) {
+        std::stringstream truncated { bytes.substr(0, length) };
+        EXPECT_THROW(
+            flat_tree::deserialize(truncated, *r.symbols()), std::runtime_error
+        ) << length;
+    }
+}
+
+TEST(FlatTreeTest, RejectsCorruptedFields) {
+    std::string source = "a = b;";
+    reader r { source };
+    grouper g { r };
+    const flat_tree tree = g.parse_flat();
+    std::stringstream buffer;
+    tree.serialize(buffer);
+    const std::string bytes = buffer.str();
+    const auto rejects = [&bytes, &r](const size_t at, const auto value) {
+        std::string patched = bytes;
+        std::memcpy(patched.data() + at, &value, sizeof value);
+        std::stringstream is { patched };
+        try {
+            (void)flat_tree::deserialize(is, *r.symbols());
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    // header, then the node arrays: kinds, groups, flags, priorities and
+    // five arrays of indices and sizes
+    const size_t n = tree.size();
+    const size_t kinds = 16;
+    const size_t groups = kinds + n;
+    const size_t token_index = groups + n * sizeof(group_kind) + 2 * n + 8 * n;
+    const size_t tokens = token_index + 12 * n;
+    uint32_t named = 0;
+    while (tree.kind(named) != node_kind::token) {
+        ++named;
+    }
+    EXPECT_TRUE(rejects(8, uint64_t { 1 } << 30));
+    EXPECT_TRUE(rejects(kinds, uint8_t { 200 }));
+    EXPECT_TRUE(rejects(groups, int { 99 }));
+    EXPECT_TRUE(rejects(token_index + 4 * named, flat_tree::none));
+    EXPECT_TRUE(rejects(tokens, uint64_t { 0xfffffff0 }));
+    EXPECT_TRUE(rejects(tokens + 8, int { 99 }));
+    EXPECT_FALSE(rejects(kinds, node_kind::group));
+}
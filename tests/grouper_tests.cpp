@@ -24,6 +24,7 @@
 
 #include <gtest/gtest.h>
 
+#include "dump_helpers.hpp"
 #include "grouper.hpp"
 
 TEST(GrouperTest, ParsesSimpleBody) {
@@ -118,6 +119,21 @@ TEST(GrouperTest, LimitTooSmallThrows) {
     }
 }
 
+TEST(GrouperTest, LimitErrorDumpsTheSqueezedNode) {
+    // the last item is squeezed before the error reports it
+    std::string input = "[a,b,c,d,e,f,g,h,(x,y)]";
+    reader r { input };
+    grouper g { r, 8 };
+    try {
+        g.parse();
+        FAIL() << "limit 8 should be too small";
+    } catch (const std::runtime_error& e) {
+        const std::string what = e.what();
+        EXPECT_NE(what.find("limit is too small"), std::string::npos);
+        EXPECT_NE(what.find("(\"y\")"), std::string::npos);
+    }
+}
+
 TEST(GrouperChainTest, ErrorScenarios) {
     struct Case {
         std::string input;
@@ -162,10 +178,443 @@ TEST(GrouperPlaceholderTest, PreservesPlaceholders) {
 
     bool has_placeholder = false;
     for (const auto& ch : body->nodes) {
-        if (std::dynamic_pointer_cast<placeholder_node>(ch)) {
+        if (node_cast<placeholder_node>(ch)) {
             has_placeholder = true;
             break;
         }
     }
     EXPECT_TRUE(has_placeholder);
-}
\ No newline at end of file
+}
+
+static size_t count_placeholders(const ast_node& node) {
+    size_t count = isa<placeholder_node>(&node) ? 1 : 0;
+    for_each_child(node, [&count](const ast_node& child) {
+        count += count_placeholders(child);
+    });
+    return count;
+}
+
+TEST(GrouperBudgetTest, SqueezesByBytes) {
+    const std::string text(1500, 'x');
+    std::string input
+        = "{['" + text + "'],['" + text + "'],['" + text + "'],[c,d]}";
+    std::string copy = input;
+    reader by_nodes { input };
+    grouper g1 { by_nodes, 64 };
+    EXPECT_EQ(count_placeholders(*g1.parse()), 0u);
+
+    reader by_bytes { copy };
+    grouper g2 { by_bytes, memory_budget { 4096 } };
+    const auto res = g2.parse();
+    EXPECT_EQ(count_placeholders(*res), 2u);
+    EXPECT_LE(res->fixed_bytes, 4096u);
+    EXPECT_LE(g2.arena_bytes(), 4096u);
+    EXPECT_GT(res->full_bytes, 4500u);
+}
+
+TEST(GrouperBudgetTest, ExpandsWithinBudget) {
+    std::string expected;
+    {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, 1u << 20 };
+        expected = dumped_tokens(*g.parse(), r.lines());
+    }
+    reader r { "test_data/test12.qc" };
+    grouper g { r, memory_budget { 32768 } };
+    const auto res = g.parse();
+    EXPECT_LE(res->fixed_bytes, 32768u);
+    EXPECT_LE(g.arena_bytes(), 32768u);
+    EXPECT_GT(res->full_bytes, 32768u);
+    EXPECT_GT(count_placeholders(*res), 0u);
+    EXPECT_EQ(dumped_tokens(*res, r.lines()), expected);
+}
+
+TEST(GrouperBudgetTest, EveryAcceptedBudgetExpands) {
+    std::string expected;
+    {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, 1u << 20 };
+        expected = dumped_tokens(*g.parse(), r.lines());
+    }
+    size_t accepted = 0;
+    for (size_t budget = 4096; budget <= 65536; budget += 512) {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, memory_budget { budget } };
+        ast_root res;
+        try {
+            res = g.parse();
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+        ++accepted;
+        // the regions squeezed under the budget expand under it as well
+        EXPECT_EQ(dumped_tokens(*res, r.lines()), expected)
+            << "budget " << budget;
+    }
+    EXPECT_GT(accepted, 100u);
+}
+
+TEST(GrouperBudgetTest, RejectsTooSmallBudget) {
+    std::string input = "{a;b;c}";
+    reader r { input };
+    EXPECT_THROW((grouper { r, memory_budget { 0 } }), std::runtime_error);
+    grouper g { r, memory_budget { 64 } };
+    EXPECT_THROW(g.parse(), std::runtime_error);
+}
+
+TEST(GrouperDepthTest, DeepNestingDoesNotRecurse) {
+    constexpr size_t depth = 200000;
+    std::string input;
+    for (size_t i = 0; i < depth; ++i) {
+        input += i % 2 == 0 ? "(" : "[";
+    }
+    input += "x";
+    for (size_t i = depth; i-- > 0;) {
+        input += i % 2 == 0 ? ")" : "]";
+    }
+    input += ";";
+    reader r { input };
+    grouper g { r };
+    const auto res = g.parse();
+    size_t wrapped = 0;
+    std::vector<const ast_node*> pending { res.get() };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        wrapped += isa<wrapped_node>(node) ? 1u : 0u;
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+    }
+    EXPECT_EQ(wrapped, depth);
+}
+
+TEST(GrouperDepthTest, LongOperatorChains) {
+    constexpr size_t length = 200000;
+    std::string input = "v";
+    for (size_t i = 0; i < length; ++i) {
+        input += " = - v";
+    }
+    input += ";";
+    reader r { input };
+    grouper g { r, size_t { 1 } << 30 };
+    const auto res = g.parse();
+    const ast_node* node = res->nodes[0].get();
+    size_t assignments = 0;
+    while (true) {
+        if (const auto group = dynamic_cast<const group_node*>(node)) {
+            node = group->nodes.back().get();
+        } else if (const auto bin = dynamic_cast<const binary_node*>(node)) {
+            ++assignments;
+            ASSERT_TRUE(isa<unary_node>(bin->lhs) || assignments == 1);
+            node = bin->rhs.get();
+        } else {
+            break;
+        }
+    }
+    EXPECT_EQ(assignments, length);
+    ASSERT_TRUE(isa<unary_node>(node));
+}
+
+static std::string parallel_source(const size_t functions) {
+    std::string input = "x = 1;\n";
+    for (size_t i = 0; i < functions; ++i) {
+        const auto n = std::to_string(i);
+        input += "f" + n + "(a, b) {\n  if (a < b) { return a + " + n
+            + "; } else { b = [a, b, " + n + "]; }\n  while (b) { b = b - 1; }"
+            + "\n  return -b * 2;\n}\n";
+        if (i % 3 == 0) {
+            input += "{ y = [" + n + ", {z}]; }\n";
+        }
+    }
+    return input;
+}
+
+TEST(GrouperParallelTest, MatchesSequentialParse) {
+    for (const size_t limit : { size_t { 1024 }, size_t { 4096 } }) {
+        std::string input = parallel_source(200);
+        std::string copy = input;
+        reader r1 { input };
+        grouper g1 { r1, limit };
+        reader r2 { copy };
+        grouper g2 { r2, limit };
+        const auto sequential = g1.parse();
+        const auto parallel = g2.parse_parallel(group_kind::file, 4);
+        std::ostringstream expected, actual;
+        sequential->dump(expected, r1.lines(), "", true, false);
+        parallel->dump(actual, r2.lines(), "", true, false);
+        EXPECT_EQ(actual.str(), expected.str());
+        std::ostringstream expected_full, actual_full;
+        sequential->dump(expected_full, r1.lines(), "", true, true);
+        parallel->dump(actual_full, r2.lines(), "", true, true);
+        EXPECT_EQ(actual_full.str(), expected_full.str());
+        EXPECT_LE(g2.arena_bytes(), g1.arena_bytes());
+    }
+}
+
+TEST(GrouperParallelTest, ReportsErrorsLikeSequentialParse) {
+    std::string input = parallel_source(20) + "g() { if { a; } }\n"
+        + parallel_source(5);
+    std::string copy = input;
+    reader r1 { input };
+    grouper g1 { r1 };
+    reader r2 { copy };
+    grouper g2 { r2 };
+    std::string expected, actual;
+    try {
+        (void)g1.parse();
+    } catch (const std::runtime_error& e) {
+        expected = e.what();
+    }
+    try {
+        (void)g2.parse_parallel(group_kind::file, 4);
+    } catch (const std::runtime_error& e) {
+        actual = e.what();
+    }
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(GrouperParallelTest, KeepsTheParseEager) {
+    // bodies large enough for the workers to squeeze their statements
+    std::string input;
+    for (int i = 0; i < 4; ++i) {
+        input += "f" + std::to_string(i) + "() {\n";
+        for (int j = 0; j < 20; ++j) {
+            input += "  x = [a, b, c, d];\n";
+        }
+        input += "}\n";
+    }
+    reader r { input };
+    grouper g { r, 32 };
+    const auto res = g.parse_parallel(group_kind::file, 4);
+    size_t placeholders = 0;
+    std::vector<const ast_node*> pending { res.get() };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        if (isa<placeholder_node>(node)) {
+            const auto& ph = static_cast<const placeholder_node&>(*node);
+            EXPECT_TRUE(ph.parsed);
+            EXPECT_EQ(ph.lazy_depth, std::numeric_limits<size_t>::max());
+            ++placeholders;
+        }
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+    }
+    EXPECT_GT(placeholders, 0u);
+}
+
+TEST(GrouperParallelTest, ChecksBracketsLikeSequentialParse) {
+    const auto message = [](std::string input, const size_t depth) {
+        reader r { input };
+        grouper g { r };
+        g.set_lazy_depth(depth);
+        try {
+            (void)g.parse_parallel(group_kind::file, 2);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    const auto max = std::numeric_limits<size_t>::max();
+    for (const size_t depth : { max, size_t { 1 } }) {
+        EXPECT_NE(
+            message("f() { a; }\ng() { b; ) }", depth)
+                .find("unbalanced close bracket: )"),
+            std::string::npos
+        );
+        EXPECT_NE(
+            message("f() { a; }\ng() { [b]", depth)
+                .find("bracket is never closed: {"),
+            std::string::npos
+        );
+        EXPECT_EQ(message("f() { a; }\ng() { x = ')'; }", depth), "");
+    }
+    // skipping every body leaves the source to the reader
+    std::string input = parallel_source(3);
+    reader r { input };
+    grouper g { r };
+    g.set_lazy_depth(0);
+    (void)g.parse_parallel(group_kind::file, 2);
+    EXPECT_EQ(r.lexed(), nullptr);
+}
+
+TEST(GrouperTest, UnbalancedBracketsFailBeforeGrouping) {
+    const auto message = [](std::string input) {
+        reader r { input };
+        grouper g { r };
+        try {
+            (void)g.parse();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    EXPECT_NE(
+        message("{ a; ( b; }").find("unbalanced close bracket: }"),
+        std::string::npos
+    );
+    EXPECT_NE(
+        message("f() { a; [b]").find("bracket is never closed: {"),
+        std::string::npos
+    );
+    EXPECT_EQ(message("x = ')'; // ("), "");
+}
+
+TEST(GrouperLazyTest, SkipsNestedBracketsUntilExpanded) {
+    std::string input = "x = [1, 2];\nf(a, b) {\n  if (a) { return [a, {b}]; }"
+                        "\n  return b;\n}\n";
+    std::string copy = input;
+    reader eager_reader { input };
+    grouper eager { eager_reader, size_t { 1 } << 20 };
+    const auto expected = dumped_tokens(*eager.parse(), eager_reader.lines());
+
+    reader r { copy };
+    grouper g { r, size_t { 1 } << 20 };
+    g.set_lazy_depth(1);
+    const auto res = g.parse();
+    std::ostringstream outline;
+    res->dump(outline, r.lines(), "", true, false);
+    EXPECT_NE(
+        outline.str().find("Placeholder(paren) [not parsed]"), std::string::npos
+    );
+    EXPECT_NE(
+        outline.str().find("Placeholder(body) [not parsed]"), std::string::npos
+    );
+    EXPECT_EQ(count_placeholders(*res), 2u);
+    EXPECT_EQ(dumped_tokens(*res, r.lines()), expected);
+    // neither the parse nor the expansions lexed the whole source
+    EXPECT_NE(eager_reader.lexed(), nullptr);
+    EXPECT_EQ(r.lexed(), nullptr);
+
+    std::ostringstream flat;
+    flat_tree { *res }.dump(flat, r.lines(), false);
+    EXPECT_EQ(flat.str(), outline.str());
+}
+
+TEST(GrouperLazyTest, ParallelWorkersKeepTheDepth) {
+    std::string input = parallel_source(30);
+    std::string copy = input;
+    reader r1 { input };
+    grouper g1 { r1, size_t { 1 } << 20 };
+    g1.set_lazy_depth(2);
+    reader r2 { copy };
+    grouper g2 { r2, size_t { 1 } << 20 };
+    g2.set_lazy_depth(2);
+    std::ostringstream expected, actual;
+    g1.parse()->dump(expected, r1.lines(), "", true, false);
+    g2.parse_parallel(group_kind::file, 4)
+        ->dump(actual, r2.lines(), "", true, false);
+    EXPECT_EQ(actual.str(), expected.str());
+    EXPECT_NE(expected.str().find("[not parsed]"), std::string::npos);
+}
+
+TEST(GrouperRecoveryTest, ReportsEveryError) {
+    std::string input = "x = \"open;\ny = 2 +;\nelse z = 3;\nv = 4);\n"
+                        "ok = 5;\nf() {\n  w = 1.;\n";
+    std::string copy = input;
+    reader throwing_reader { copy };
+    grouper throwing { throwing_reader };
+    EXPECT_THROW(throwing.parse(), std::runtime_error);
+
+    reader r { input };
+    grouper g { r };
+    std::vector<diagnostic> errors;
+    g.set_diagnostics(&errors);
+    const auto root = g.parse();
+    const std::vector<std::pair<int, std::string>> expected {
+        { 0, "missing closing quote" },
+        { 1, "unexpected end" },
+        { 2, "invalid predecessor for keyword: else" },
+        { 3, "unbalanced close bracket: )" },
+        { 5, "bracket is never closed: {" },
+        { 6, "digit expected after decimal" },
+    };
+    ASSERT_EQ(errors.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(errors[i].pos.line, expected[i].first) << i;
+        EXPECT_EQ(errors[i].message, expected[i].second) << i;
+    }
+    std::ostringstream os;
+    root->dump(os, r.lines(), "", true, false);
+    EXPECT_NE(
+        os.str().find("Token(error) <0:4>(\"\"open\")"), std::string::npos
+    );
+    EXPECT_NE(os.str().find("Token(error) <3:5>(\")\")"), std::string::npos);
+    EXPECT_NE(os.str().find("Token(keyword) <4:0>(\"ok\")"), std::string::npos);
+    EXPECT_EQ(r.diagnostics(), nullptr);
+}
+
+TEST(GrouperRecoveryTest, MissingOperandsAreReported) {
+    std::string input = "x = % y;\na = 1 +; b = * 2;\nc = 3;\n";
+    reader r { input };
+    grouper g { r };
+    std::vector<diagnostic> errors;
+    g.set_diagnostics(&errors);
+    const auto root = g.parse();
+    const std::vector<std::pair<int, std::string>> expected {
+        { 0, "expected operand" },
+        { 1, "unexpected end" },
+        { 1, "expected operand" },
+    };
+    ASSERT_EQ(errors.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(errors[i].pos.line, expected[i].first) << i;
+        EXPECT_EQ(errors[i].message, expected[i].second) << i;
+    }
+    // the malformed commands keep their tokens, the next one parses
+    ASSERT_GE(root->size(), 4u);
+    const auto good = node_cast<group_node>(root->nodes[3]);
+    ASSERT_TRUE(good);
+    ASSERT_EQ(good->size(), 1u);
+    const auto assign = node_cast<binary_node>(good->nodes.front());
+    ASSERT_TRUE(assign);
+    EXPECT_EQ(assign->op.word, "=");
+    EXPECT_EQ(r.lines().locate(assign->op.offset).line, 2);
+}
+
+TEST(GrouperRecoveryTest, CleanSourceParsesAsUsual) {
+    std::ostringstream expected, actual;
+    {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, 64 };
+        g.parse()->dump(expected, r.lines(), "", true, true);
+    }
+    reader r { "test_data/test12.qc" };
+    grouper g { r, 64 };
+    std::vector<diagnostic> errors;
+    g.set_diagnostics(&errors);
+    g.parse()->dump(actual, r.lines(), "", true, true);
+    EXPECT_TRUE(errors.empty());
+    EXPECT_EQ(actual.str(), expected.str());
+}
+
+TEST(GrouperRecoveryTest, SqueezedRegionsReportOnExpansion) {
+    std::string input;
+    for (int i = 0; i < 6; ++i) {
+        input += "f" + std::to_string(i)
+            + " = fu() {\n  a = 1 + ;\n  b = 2;\n};\n";
+    }
+    for (const size_t lazy : { size_t { 0 }, size_t { 64 } }) {
+        std::string copy = input;
+        reader r { copy };
+        grouper g { r, 8 };
+        g.set_lazy_depth(lazy);
+        std::vector<diagnostic> errors;
+        g.set_diagnostics(&errors);
+        const auto root = g.parse();
+        EXPECT_TRUE(errors.empty());
+        for (int pass = 0; pass < 2; ++pass) {
+            std::ostringstream os;
+            EXPECT_NO_THROW(root->dump(os, r.lines(), "", true, true));
+            EXPECT_NE(
+                os.str().find("Token(keyword) <22:2>(\"b\")"), std::string::npos
+            );
+            ASSERT_EQ(errors.size(), 6u);
+        }
+        EXPECT_EQ(errors[5].pos.line, 21);
+        EXPECT_EQ(errors[5].message, "unexpected end");
+    }
+}
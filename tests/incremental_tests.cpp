@@ -0,0 +1,221 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "dump_helpers.hpp"
+#include "grouper.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+static std::string load(const std::string& path) {
+    std::ifstream file { path };
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+/// Dump of @p text parsed from scratch with the given limit and lazy depth.
+static std::string fresh(
+    std::string text, const size_t limit, const bool full,
+    const size_t lazy = std::numeric_limits<size_t>::max()
+) {
+    reader r { text };
+    grouper g { r, limit };
+    g.set_lazy_depth(lazy);
+    return dumped(*g.parse(), r.lines(), full);
+}
+
+/// Text of @p text after @p edit.
+static std::string edited(std::string text, const text_edit& edit) {
+    return text.replace(edit.offset, edit.removed, edit.inserted);
+}
+
+static constexpr size_t unlimited = size_t { 1 } << 30;
+
+TEST(IncrementalTest, EditInsideBodyMatchesFreshParse) {
+    std::string text = load("test_data/test12.qc");
+    const auto at = text.find("0.618");
+    ASSERT_NE(at, std::string::npos);
+    const text_edit edit { at, 5, "0.5 + rate * 2" };
+    const auto expected = edited(text, edit);
+
+    reader r { text };
+    grouper g { r, unlimited };
+    const auto root = g.parse();
+    const auto* untouched = root->nodes.front().get();
+    const size_t whole = g.arena_bytes();
+    const auto result = g.reparse(root, edit);
+    EXPECT_EQ(result.get(), root.get());
+    EXPECT_EQ(result->nodes.front().get(), untouched);
+    EXPECT_LT(g.arena_bytes(), whole);
+    EXPECT_EQ(r.source(), expected);
+    EXPECT_EQ(
+        dumped(*result, r.lines(), false), fresh(expected, unlimited, false)
+    );
+}
+
+TEST(IncrementalTest, LaterPositionsMove) {
+    std::string text = load("test_data/test12.qc");
+    std::string current = text;
+    reader r { text };
+    grouper g { r, unlimited };
+    auto root = g.parse();
+    // lines added and removed inside a body, then a token split in two
+    const std::vector<std::pair<std::string, std::string>> edits {
+        { "lambda = 0.618;", "lambda = 0.618;\n    // tuned\n    beta = 2;" },
+        { "    // tuned\n    beta = 2;", "" },
+        { "acc = 0;", "acc = 0 ;" },
+        { "array_size", "array size" },
+    };
+    for (const auto& [before, after] : edits) {
+        const auto at = current.find(before);
+        ASSERT_NE(at, std::string::npos) << before;
+        const text_edit edit { at, before.size(), after };
+        current = edited(current, edit);
+        root = g.reparse(root, edit);
+        ASSERT_EQ(
+            dumped(*root, r.lines(), false), fresh(current, unlimited, false)
+        ) << after;
+    }
+}
+
+TEST(IncrementalTest, StructuralEditsFallBack) {
+    std::string text = "f(a) {\n  x = a;\n}\ng(b) {\n  return b;\n}\n";
+    std::string current = text;
+    reader r { text };
+    grouper g { r, unlimited };
+    auto root = g.parse();
+    // a new top-level command, then a body split in two
+    for (const text_edit& edit :
+         { text_edit { 0, 0, "y = 1;\n" },
+           text_edit { 23, 0, "}\nh() {\n" } }) {
+        current = edited(current, edit);
+        root = g.reparse(root, edit);
+        EXPECT_EQ(
+            dumped(*root, r.lines(), false), fresh(current, unlimited, false)
+        );
+    }
+    EXPECT_THROW(
+        g.reparse(root, { current.find('{'), 1, "" }), std::runtime_error
+    );
+}
+
+TEST(IncrementalTest, SqueezedRegionsMatchFreshParse) {
+    std::string text = load("test_data/test12.qc");
+    std::string current = text;
+    reader r { text };
+    grouper g { r, 64 };
+    auto root = g.parse();
+    for (const auto& [before, after] :
+         std::vector<std::pair<std::string, std::string>> {
+             { "acc = 0;", "acc = 1 + 2 * 3;" },
+             { "if(j % 2 == 0)", "if(j % 3 == 1 && j > 4)" },
+             { "13,21,5", "13,21,5,7,7" } }) {
+        const auto at = current.find(before);
+        ASSERT_NE(at, std::string::npos) << before;
+        const text_edit edit { at, before.size(), after };
+        current = edited(current, edit);
+        root = g.reparse(root, edit);
+        ASSERT_EQ(dumped(*root, r.lines(), true), fresh(current, 64, true))
+            << after;
+    }
+}
+
+TEST(IncrementalTest, KeepsTheLazyDepth) {
+    std::string text
+        = "f(a) {\n  if (a) { return [a, {b}]; }\n  return a;\n}\n";
+    const text_edit edit { text.find("return a;"), 8, "return a + 1" };
+    const auto current = edited(text, edit);
+    reader r { text };
+    grouper g { r, unlimited };
+    g.set_lazy_depth(1);
+    const auto root = g.parse();
+    const auto result = g.reparse(root, edit);
+    EXPECT_EQ(
+        dumped(*result, r.lines(), false), fresh(current, unlimited, false, 1)
+    );
+    EXPECT_EQ(
+        dumped(*result, r.lines(), true), fresh(current, unlimited, true, 1)
+    );
+}
+
+/// Full dump of @p root, or the error that expanding it raises.
+static std::string
+expanded(const ast_node& root, const line_index& lines) {
+    try {
+        return dumped(root, lines, true);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+}
+
+TEST(IncrementalTest, ExpansionErrorsMatchFreshParse) {
+    std::string text = "f(a) {\n  return a ^ ((b << 1) | c);\n}\n";
+    const text_edit edit { text.find(" << 1"), 0, ";" };
+    const auto current = edited(text, edit);
+    reader r { text };
+    grouper g { r, unlimited };
+    g.set_lazy_depth(1);
+    const auto result = g.reparse(g.parse(), edit);
+    std::string copy = current;
+    reader fresh_reader { copy };
+    grouper fresh_grouper { fresh_reader, unlimited };
+    fresh_grouper.set_lazy_depth(1);
+    const auto fresh_root = fresh_grouper.parse();
+    const auto expected = expanded(*fresh_root, fresh_reader.lines());
+    EXPECT_NE(expected.find("PlaceholderNode-Error"), std::string::npos);
+    EXPECT_EQ(expanded(*result, r.lines()), expected);
+}
+
+TEST(IncrementalTest, UnbalancedSqueezedRegionFallsBack) {
+    std::string text = load("test_data/test12.qc");
+    const auto at = text.find("fu(arr){");
+    ASSERT_NE(at, std::string::npos);
+    reader r { text };
+    grouper g { r, 512 };
+    const auto root = g.parse();
+    // the body of the function loses its opening bracket, so its closing
+    // one is left over
+    EXPECT_THROW(g.reparse(root, { at + 7, 2, "\n" }), std::runtime_error);
+}
+
+TEST(IncrementalTest, EarlierTokensKeepTheirText) {
+    std::string text = "a = 1;\nb = 2;\nc = 3;\n";
+    reader r { text };
+    grouper g { r, unlimited };
+    auto root = g.parse();
+    // an edit that outgrows the source copies it with room to spare, so the
+    // next one is made in place
+    root = g.reparse(root, { r.source().find('3'), 1, "3 + 4" });
+    const auto* first = r.source().data();
+    root = g.reparse(root, { r.source().find('4'), 1, "5 + 6" });
+    EXPECT_EQ(r.source().data(), first);
+    EXPECT_EQ(
+        dumped(*root, r.lines(), false),
+        fresh("a = 1;\nb = 2;\nc = 3 + 5 + 6;\n", unlimited, false)
+    );
+}
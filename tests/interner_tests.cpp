@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "interner.hpp"
+#include "lexer.hpp"
+#include "reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(InternerTest, ReservedWordsHaveFixedIds) {
+    interner table;
+    EXPECT_EQ(table.intern("if"), static_cast<uint32_t>(reserved::kw_if));
+    EXPECT_EQ(table.intern("goto"), static_cast<uint32_t>(reserved::kw_goto));
+    EXPECT_EQ(
+        table.name(static_cast<uint32_t>(reserved::kw_finally)), "finally"
+    );
+    EXPECT_EQ(table.name(static_cast<uint32_t>(reserved::none)), "");
+    EXPECT_NE(table.intern(""), static_cast<uint32_t>(reserved::none));
+    EXPECT_EQ(reserved_word("elif"), reserved::kw_elif);
+    EXPECT_EQ(reserved_word("iff"), reserved::none);
+    EXPECT_EQ(reserved_name(reserved::kw_catch), "catch");
+}
+
+TEST(InternerTest, EqualNamesShareIds) {
+    interner table;
+    const auto a = table.intern("alpha");
+    const std::string copy = "alpha";
+    EXPECT_EQ(table.intern(copy), a);
+    EXPECT_NE(table.intern("beta"), a);
+    EXPECT_EQ(table.name(a), "alpha");
+    EXPECT_EQ(table.name(static_cast<uint32_t>(table.size())), "");
+}
+
+TEST(InternerTest, ConcurrentInterning) {
+    interner table;
+    const size_t before = table.size();
+    constexpr int names = 1000;
+    std::vector<std::vector<uint32_t>> seen(4);
+    std::vector<std::thread> workers;
+    for (auto& ids : seen) {
+        workers.emplace_back([&table, &ids] {
+            for (int i = 0; i < names; ++i) {
+                ids.push_back(table.intern("name" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    EXPECT_EQ(table.size(), before + names);
+    for (const auto& ids : seen) {
+        EXPECT_EQ(ids, seen.front());
+    }
+    EXPECT_EQ(table.name(seen[0][42]), "name42");
+}
+
+TEST(InternerTest, TokenStreamTagsKeywords) {
+    std::string text = "while x return;";
+    reader r { text };
+    const auto& stream = r.tokens();
+    ASSERT_EQ(stream.size(), 5u);
+    EXPECT_EQ(stream.symbol(0), static_cast<uint32_t>(reserved::kw_while));
+    EXPECT_EQ(stream.symbol(1), r.symbols()->intern("x"));
+    EXPECT_EQ(stream.symbol(2), static_cast<uint32_t>(reserved::kw_return));
+    EXPECT_EQ(stream.symbol(3), 0u);
+}
+
+TEST(InternerTest, ReadersOwnTheirTables) {
+    std::string first_text = "alpha beta";
+    std::string second_text = "beta";
+    reader first { first_text };
+    reader second { second_text };
+    (void)second.tokens();
+    EXPECT_NE(first.symbols(), second.symbols());
+    EXPECT_EQ(first.symbols()->size(), second.symbols()->size() - 1);
+    const auto table = std::make_shared<interner>();
+    first.set_symbols(table);
+    EXPECT_EQ(first.tokens().symbol(0), table->intern("alpha"));
+}
+
+TEST(InternerTest, ChunkedLexingIdsInTheReaderTable) {
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "name" + std::to_string(i % 17) + " = if_" + std::to_string(i)
+            + "; while x;\n";
+    }
+    reader r { text };
+    token_columns columns;
+    lexer::tokenize(r, columns, false, 4, 64);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns.kinds[i] == static_cast<uint8_t>(token_kind::keyword)) {
+            EXPECT_EQ(
+                r.symbols()->name(columns.symbols[i]),
+                r.source().substr(columns.offsets[i], columns.lengths[i])
+            );
+        }
+    }
+    // the reserved words, 17 names, 200 if_ names and x; nothing the
+    // chunks saw leaks in otherwise
+    EXPECT_EQ(r.symbols()->size(), 13u + 17u + 200u + 1u);
+}
@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "lexer.hpp"
+
+#include <gtest/gtest.h>
+
+static std::vector<token>
+lex_sequential(const std::string_view text, const bool keep_trivia) {
+    reader r { borrowed_source, text };
+    std::vector<token> tokens;
+    token t;
+    do {
+        if (!keep_trivia) {
+            r.skip_trivia();
+        }
+        r.next_token(t);
+        tokens.push_back(t);
+    } while (t.kind != token_kind::eof);
+    return tokens;
+}
+
+static void expect_same_tokens(
+    const std::vector<token>& expected, const std::vector<token>& actual
+) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].kind, actual[i].kind) << i;
+        EXPECT_EQ(expected[i].word, actual[i].word) << i;
+        EXPECT_EQ(expected[i].offset, actual[i].offset) << i;
+        EXPECT_EQ(expected[i].op, actual[i].op) << i;
+        const auto want = expected[i].number();
+        const auto got = actual[i].number();
+        EXPECT_EQ(want.integer, got.integer) << i;
+        EXPECT_EQ(want.floating, got.floating) << i;
+    }
+}
+
+TEST(LexerTest, ChunkedMatchesSequential) {
+    // quotes inside comments and comment markers inside strings make many
+    // speculative chunk starts guess wrong
+    const std::string text
+        = "a = \"/* not a comment */ still 'string'\";\n"
+          "// it's a \"comment\"\n"
+          "/* multi\n line ' \" */ b += c[0] * 1.5e3;\n"
+          "s = 'x // y';\nf(a, b) { return a / b; }\n"
+          "t = \"tab\\there\" + 42 - 'q\\'s';\n";
+    for (const bool keep_trivia : { false, true }) {
+        const auto expected = lex_sequential(text, keep_trivia);
+        for (const size_t chunk : { 1u, 2u, 3u, 7u, 16u, 64u, 4096u }) {
+            std::string copy = text;
+            reader r { copy };
+            expect_same_tokens(
+                expected, lexer::tokenize(r, keep_trivia, 4, chunk)
+            );
+        }
+    }
+}
+
+TEST(LexerTest, ReportsFirstError) {
+    std::string text = "a = 1;\nb = \"unterminated;\n";
+    reader r { text };
+    EXPECT_THROW(lexer::tokenize(r, false, 2, 4), std::runtime_error);
+}
+
+TEST(LexerTest, EmptySource) {
+    std::string text;
+    reader r { text };
+    const auto tokens = lexer::tokenize(r);
+    ASSERT_EQ(tokens.size(), 1u);
+    EXPECT_EQ(tokens[0].kind, token_kind::eof);
+}
+
+TEST(LexerTest, TokenStreamMatchesReader) {
+    const std::string text
+        = "x = \"a\\tb\" + 'plain';\n// note\nf(x) { y[0] } 2.5e3\n";
+    const auto expected = lex_sequential(text, false);
+    std::string copy = text;
+    reader r { copy };
+    const auto& stream = r.tokens();
+    EXPECT_EQ(&stream, &r.tokens());
+    ASSERT_EQ(stream.size(), expected.size());
+    std::vector<token> actual(stream.size());
+    for (size_t i = 0; i < stream.size(); ++i) {
+        stream.read(i, actual[i]);
+        EXPECT_EQ(stream.literal(i), expected[i].text()) << i;
+        EXPECT_EQ(stream.number(i).floating, expected[i].number().floating)
+            << i;
+    }
+    expect_same_tokens(expected, actual);
+    EXPECT_EQ(stream.find(0), 0u);
+    EXPECT_EQ(stream.find(expected[4].offset - 1), 4u);
+    EXPECT_EQ(
+        stream.find(static_cast<std::streamoff>(text.size())), stream.size() - 1
+    );
+}
+
+TEST(LexerTest, TokenStreamRemembersLexErrors) {
+    std::string text = "x = \"open;\n";
+    reader r { text };
+    const auto message = [&r] {
+        try {
+            (void)r.tokens();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    const auto first = message();
+    EXPECT_NE(first, "");
+    EXPECT_EQ(message(), first);
+    EXPECT_EQ(r.lexed(), nullptr);
+    r.edit({ 10, 0, "\"" });
+    EXPECT_EQ(message(), "");
+    EXPECT_EQ(r.lexed(), &r.tokens());
+}
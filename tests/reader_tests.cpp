@@ -26,6 +26,9 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <type_traits>
+
 TEST(ReaderTest, Constructor) {
     std::string str;
     reader r { str };
@@ -185,17 +188,39 @@ TEST(ReaderTest, FileOpenFailure) {
     EXPECT_THROW(reader r { "nonexistent_file.qc" }, std::invalid_argument);
 }
 
+TEST(ReaderTest, RejectsEmptyBuffer) {
+    static_assert(!std::is_copy_constructible_v<reader>);
+    static_assert(!std::is_copy_assignable_v<reader>);
+    static_assert(!std::is_move_constructible_v<reader>);
+    static_assert(!std::is_move_assignable_v<reader>);
+    for (const auto mode : { input_mode::mapped, input_mode::stream }) {
+        EXPECT_THROW(
+            (reader { "test_data/test00.qc", 0, mode }), std::invalid_argument
+        );
+    }
+}
+
 TEST(ReaderTest, TokenDump) {
+    const line_index lines { "\n 42" };
     token t;
     t.kind = token_kind::integer;
-    t.pos.line = 1;
-    t.pos.column = 2;
+    t.offset = 2;
     t.word = "42";
     std::ostringstream oss1;
     std::ostringstream oss2;
-    t.dump(oss1);
-    t.dump(oss2, "", true);
+    t.dump(oss1, lines);
+    t.dump(oss2, lines, "", true);
     EXPECT_EQ(oss1.str(), oss2.str());
+    EXPECT_NE(oss1.str().find("1:1"), std::string::npos) << oss1.str();
+}
+
+TEST(ReaderTest, TokenStaysSmall) {
+    static_assert(sizeof(token) <= 32);
+    std::string str = "12.5";
+    reader r { str };
+    token t;
+    r.next_token(t);
+    EXPECT_DOUBLE_EQ(t.number().floating, 12.5);
 }
 
 TEST(ReaderTest, MissingClosingComment) {
@@ -219,9 +244,363 @@ TEST(ReaderTest, InvalidEscapeSequence) {
     EXPECT_THROW(r.next_token(t), std::runtime_error);
 }
 
+TEST(ReaderTest, ErrorsCarryMessageAndPosition) {
+    std::string str = "a\n  \"open";
+    reader r { str };
+    token t;
+    r.next_token(t);
+    r.skip_trivia();
+    try {
+        r.next_token(t);
+        FAIL() << "expected a reader_error";
+    } catch (const reader_error& e) {
+        EXPECT_EQ(e.message, "missing closing quote");
+        EXPECT_EQ(e.pos.line, 1);
+        EXPECT_EQ(e.pos.column, 7);
+    }
+}
+
 TEST(ReaderTest, MissingClosingQuote) {
     std::string str = "\"no end";
     reader r { str };
     token t;
     EXPECT_THROW(r.next_token(t), std::runtime_error);
 }
+
+static std::filesystem::path write_temp_file(
+    const std::string& name, const std::string& content
+) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+    return path;
+}
+
+TEST(ReaderTest, MappedMatchesStream) {
+    std::string content;
+    for (int i = 0; i < 64; ++i) {
+        content += "value_" + std::to_string(i) + " = 3.25e+2 * (x["
+            + std::to_string(i) + "]); // note\n/* block\n */ \"s\\n\";\n";
+    }
+    const auto path = write_temp_file("qpiler_mapped.qc", content);
+    reader mapped { path, 16, input_mode::mapped };
+    reader streamed { path, 16, input_mode::stream };
+    EXPECT_TRUE(mapped.is_mapped());
+    EXPECT_FALSE(streamed.is_mapped());
+    token a;
+    token b;
+    do {
+        mapped.next_token(a);
+        streamed.next_token(b);
+        ASSERT_EQ(a.kind, b.kind);
+        ASSERT_EQ(a.word, b.word);
+        ASSERT_EQ(a.offset, b.offset);
+    } while (a.kind != token_kind::eof);
+    const auto& lines = mapped.lines();
+    EXPECT_EQ(lines.lines(), streamed.lines().lines());
+    EXPECT_EQ(lines.size(), streamed.lines().size());
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, MappedJumpToPosition) {
+    const auto path = write_temp_file("qpiler_jump.qc", "alpha beta\ngamma");
+    reader r { path };
+    ASSERT_TRUE(r.is_mapped());
+    token t;
+    r.next_token(t);
+    r.next_token(t);
+    const position beta = r.get_position();
+    r.next_token(t);
+    EXPECT_EQ(t.word, "beta");
+    r.next_token(t);
+    r.next_token(t);
+    EXPECT_EQ(t.word, "gamma");
+    EXPECT_EQ(r.lines().locate(t.offset).line, 1);
+    r.jump_to_position(beta);
+    r.next_token(t);
+    EXPECT_EQ(t.word, "beta");
+    EXPECT_EQ(t.offset, 6);
+    EXPECT_THROW(r.jump_to_position({ 1024, 0, 0 }), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, EmptyFileFallsBackToStream) {
+    const auto path = write_temp_file("qpiler_empty.qc", "");
+    reader r { path };
+    EXPECT_FALSE(r.is_mapped());
+    token t;
+    r.next_token(t);
+    EXPECT_EQ(t.kind, token_kind::eof);
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, StringTextIsDecodedLazily) {
+    std::string str = R"("tab\there \u00e9\\")";
+    reader r { str };
+    token t;
+    r.next_token(t);
+    ASSERT_EQ(t.kind, token_kind::string);
+    EXPECT_EQ(t.word, R"(tab\there \u00e9\\)");
+    EXPECT_EQ(t.text(), "tab\there \xC3\xA9\\");
+}
+
+TEST(ReaderTest, StreamTokensOutliveChunks) {
+    const auto path = write_temp_file(
+        "qpiler_chunks.qc", "identifier_longer_than_chunk + \"quoted text\""
+    );
+    reader r { path, 4, input_mode::stream };
+    std::vector<token> tokens;
+    token t;
+    do {
+        r.next_token(t);
+        tokens.push_back(t);
+    } while (t.kind != token_kind::eof);
+    ASSERT_EQ(tokens.size(), 6u);
+    EXPECT_EQ(tokens[0].word, "identifier_longer_than_chunk");
+    EXPECT_EQ(tokens[2].word, "+");
+    EXPECT_EQ(tokens[4].word, "quoted text");
+    EXPECT_EQ(tokens[4].offset, 31);
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, StreamChunksAreRetainedOnRequest) {
+    const auto path = write_temp_file("qpiler_retain.qc", "abc def ghi jkl");
+    reader r { path, 4, input_mode::stream };
+    r.set_retain_chunks(false);
+    token t;
+    r.next_token(t);
+    EXPECT_EQ(t.word, "abc");
+    r.set_retain_chunks(true);
+    std::vector<token> tokens;
+    do {
+        r.skip_trivia();
+        r.next_token(t);
+        tokens.push_back(t);
+    } while (t.kind != token_kind::eof);
+    ASSERT_EQ(tokens.size(), 4u);
+    EXPECT_EQ(tokens[0].word, "def");
+    EXPECT_EQ(tokens[1].word, "ghi");
+    EXPECT_EQ(tokens[2].word, "jkl");
+    EXPECT_EQ(r.lines().locate(tokens[2].offset).column, 12);
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, SkipTrivia) {
+    const std::string source = "  // line\n /* block\n */ a / b /";
+    for (const auto mode : { input_mode::mapped, input_mode::stream }) {
+        const auto path = write_temp_file("qpiler_trivia.qc", source);
+        reader r { path, 3, mode };
+        token t;
+        r.skip_trivia();
+        r.next_token(t);
+        EXPECT_EQ(t.word, "a");
+        EXPECT_EQ(r.lines().locate(t.offset).line, 2);
+        EXPECT_EQ(r.lines().locate(t.offset).column, 4);
+        r.skip_trivia();
+        r.next_token(t);
+        EXPECT_EQ(t.kind, token_kind::special_character);
+        EXPECT_EQ(t.word, "/");
+        EXPECT_EQ(r.lines().locate(t.offset).column, 6);
+        r.skip_trivia();
+        r.next_token(t);
+        EXPECT_EQ(t.word, "b");
+        r.skip_trivia();
+        r.next_token(t);
+        EXPECT_EQ(t.word, "/");
+        EXPECT_EQ(t.offset, 30);
+        r.skip_trivia();
+        r.next_token(t);
+        EXPECT_EQ(t.kind, token_kind::eof);
+        std::filesystem::remove(path);
+    }
+}
+
+TEST(ReaderTest, LineIndexMatchesIncrementalPositions) {
+    const std::string source = "a = 'multi\nline';\n/* x\n\n */ b\t+= 42\n"
+                               "// tail\n\n  c(\"\\n\")";
+    std::string plain_copy = source;
+    std::string indexed_copy = source;
+    reader plain { plain_copy };
+    reader indexed { indexed_copy };
+    EXPECT_EQ(indexed.indexed(), nullptr);
+    const auto& lines = indexed.lines();
+    EXPECT_EQ(indexed.indexed(), &lines);
+    EXPECT_EQ(lines.lines(), 8u);
+    std::vector<position> starts;
+    token a;
+    token b;
+    do {
+        const position at = plain.get_position();
+        plain.next_token(a);
+        indexed.next_token(b);
+        ASSERT_EQ(a.word, b.word);
+        EXPECT_EQ(a.offset, b.offset);
+        const position found = lines.locate(b.offset);
+        EXPECT_EQ(found.line, at.line) << a.word;
+        EXPECT_EQ(found.column, at.column) << a.word;
+        starts.push_back(at);
+    } while (a.kind != token_kind::eof);
+
+    for (auto it = starts.rbegin(); it != starts.rend(); ++it) {
+        indexed.jump_to_position({ it->offset, 0, 0 });
+        const auto pos = indexed.get_position();
+        EXPECT_EQ(pos.line, it->line);
+        EXPECT_EQ(pos.column, it->column);
+    }
+}
+
+TEST(ReaderTest, LineIndexFollowsStreamChunks) {
+    const auto path = write_temp_file("qpiler_index.qc", "a\nbb\n\nccc d");
+    reader streamed { path, 2, input_mode::stream };
+    token t;
+    streamed.next_token(t);
+    streamed.next_token(t);
+    const auto& lines = streamed.lines();
+    EXPECT_LT(lines.size(), 11u);
+    do {
+        streamed.skip_trivia();
+        streamed.next_token(t);
+    } while (t.kind != token_kind::eof);
+    EXPECT_EQ(lines.lines(), 4u);
+    EXPECT_EQ(lines.size(), 11u);
+    const position d = lines.locate(10);
+    EXPECT_EQ(d.line, 3);
+    EXPECT_EQ(d.column, 4);
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, OperatorsUseMaximalMunch) {
+    const std::string source = "a<<=b>>c&&!d+++e/=f- -g@?h:i";
+    const std::vector<std::pair<std::string_view, op_kind>> expected {
+        { "<<=", op_kind::shl_assign },  { ">>", op_kind::shr },
+        { "&&", op_kind::logical_and },  { "!", op_kind::logical_not },
+        { "++", op_kind::increment },    { "+", op_kind::plus },
+        { "/=", op_kind::div_assign },   { "-", op_kind::minus },
+        { "-", op_kind::minus },         { "@", op_kind::none },
+        { "?", op_kind::question },
+    };
+    const auto path = write_temp_file("qpiler_operators.qc", source);
+    for (const auto mode : { input_mode::mapped, input_mode::stream }) {
+        reader r { path, 2, mode };
+        token t;
+        size_t i = 0;
+        while (true) {
+            r.skip_trivia();
+            r.next_token(t);
+            if (t.kind == token_kind::eof) {
+                break;
+            }
+            if (t.kind != token_kind::special_character) {
+                const bool colon = t.kind == token_kind::separator;
+                EXPECT_EQ(t.op, colon ? op_kind::colon : op_kind::none);
+                continue;
+            }
+            ASSERT_LT(i, expected.size());
+            EXPECT_EQ(t.word, expected[i].first);
+            EXPECT_EQ(t.op, expected[i].second);
+            ++i;
+        }
+        EXPECT_EQ(i, expected.size());
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, NumericValues) {
+    const auto number = [](std::string str) {
+        reader r { str };
+        token t;
+        r.next_token(t);
+        return t.number();
+    };
+    EXPECT_EQ(number("0").integer, 0u);
+    EXPECT_EQ(number("2147483647").integer, 2147483647u);
+    EXPECT_EQ(number("18446744073709551615").integer, UINT64_MAX);
+    EXPECT_FALSE(number("18446744073709551615").out_of_range);
+    EXPECT_TRUE(number("18446744073709551616").out_of_range);
+    const auto big = number(std::string(1024, '9'));
+    EXPECT_TRUE(big.out_of_range);
+    EXPECT_EQ(big.integer, UINT64_MAX);
+
+    EXPECT_DOUBLE_EQ(number("2.71828").floating, 2.71828);
+    EXPECT_DOUBLE_EQ(number("168.861E+012").floating, 168.861e12);
+    EXPECT_DOUBLE_EQ(number("0." + std::string(1022, '9')).floating, 1.0);
+    EXPECT_FALSE(number("0.0000123456789").out_of_range);
+    for (const auto& huge :
+         { std::string("1E456"), std::string("73.84e+789"),
+           std::string(1022, '9') + ".0",
+           "1" + std::string(400, '0') + "e-10" }) {
+        const auto value = number(huge);
+        EXPECT_TRUE(value.out_of_range) << huge;
+        EXPECT_TRUE(std::isinf(value.floating)) << huge;
+    }
+    for (const auto& tiny : { "15e-345", "0.00000001e-340", "42.42E-678" }) {
+        const auto value = number(tiny);
+        EXPECT_TRUE(value.out_of_range) << tiny;
+        EXPECT_EQ(value.floating, 0.0) << tiny;
+    }
+}
+
+TEST(ReaderTest, EditReplacesSourceAndRewinds) {
+    std::string source = "alpha beta\ngamma";
+    reader r { source };
+    token t;
+    r.next_token(t);
+    r.edit({ 6, 4, "delta epsilon" });
+    EXPECT_EQ(r.source(), "alpha delta epsilon\ngamma");
+    EXPECT_EQ(r.get_position().offset, 0);
+    r.next_token(t);
+    r.next_token(t);
+    r.next_token(t);
+    EXPECT_EQ(t.word, "delta");
+    EXPECT_EQ(t.offset, 6);
+
+    token moved = t;
+    r.edit({ 0, 6, "" });
+    moved.offset -= 6;
+    r.relocate(moved);
+    EXPECT_EQ(moved.word, "delta");
+    EXPECT_EQ(moved.word.data(), r.source().data());
+    EXPECT_THROW(r.edit({ 19, 1, "" }), std::runtime_error);
+    EXPECT_THROW(r.edit({ 20, 0, "" }), std::runtime_error);
+}
+
+TEST(ReaderTest, EditRequiresResidentSource) {
+    const auto path = write_temp_file("qpiler_edit.qc", "a\nb");
+    reader streamed { path, 4096, input_mode::stream };
+    EXPECT_THROW(streamed.edit({ 0, 1, "c" }), std::runtime_error);
+    reader mapped { path };
+    mapped.edit({ 0, 1, "c" });
+    EXPECT_FALSE(mapped.is_mapped());
+    EXPECT_EQ(mapped.source(), "c\nb");
+    std::filesystem::remove(path);
+}
+
+TEST(ReaderTest, RecoveringReaderYieldsErrorTokens) {
+    std::string source = "a = 1.e; b /* open\nc";
+    reader r { source };
+    std::vector<diagnostic> errors;
+    r.set_diagnostics(&errors);
+    std::vector<std::pair<token_kind, std::string>> tokens;
+    token t;
+    do {
+        r.skip_trivia();
+        r.next_token(t);
+        tokens.emplace_back(t.kind, std::string(t.word));
+    } while (t.kind != token_kind::eof);
+    const std::vector<std::pair<token_kind, std::string>> expected {
+        { token_kind::keyword, "a" },
+        { token_kind::special_character, "=" },
+        { token_kind::error, "1.e" },
+        { token_kind::separator, ";" },
+        { token_kind::keyword, "b" },
+        { token_kind::error, "/* open" },
+        { token_kind::keyword, "c" },
+        { token_kind::eof, "" },
+    };
+    EXPECT_EQ(tokens, expected);
+    ASSERT_EQ(errors.size(), 2u);
+    EXPECT_EQ(errors[0].pos.column, 4);
+    EXPECT_EQ(errors[0].message, "digit expected after decimal");
+    EXPECT_EQ(errors[1].pos.column, 11);
+    EXPECT_EQ(errors[1].message, "missing closing comment delimiter");
+}
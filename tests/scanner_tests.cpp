@@ -0,0 +1,84 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "scanner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+static std::string random_text(std::mt19937& gen, const size_t size) {
+    static constexpr std::string_view alphabet
+        = " \t\n\r\v\f_09azAZ+/*\"\\\x80\xff\x7f(){}[]'";
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::string text(size, ' ');
+    for (auto& c : text) {
+        c = alphabet[pick(gen)];
+    }
+    return text;
+}
+
+TEST(ScannerTest, RunsStopAtClassBoundary) {
+    EXPECT_EQ(scanner::whitespace_run(" \t\r\n\v\fx  "), 6u);
+    EXPECT_EQ(scanner::identifier_run("_abc_XYZ_019+"), 12u);
+    EXPECT_EQ(scanner::digit_run("0123456789a"), 10u);
+    EXPECT_EQ(scanner::digit_run(""), 0u);
+    EXPECT_EQ(scanner::identifier_run("caf\xC3\xA9"), 3u);
+    EXPECT_EQ(scanner::count_newlines("a\nb\n\nc"), 3u);
+}
+
+TEST(ScannerTest, KernelsAgreeWithScalar) {
+    const auto initial = scanner::active_kernel();
+    std::mt19937 gen(42);
+    for (const auto kernel : { scan_kernel::sse2, scan_kernel::avx2 }) {
+        if (!scanner::use_kernel(kernel)) {
+            continue;
+        }
+        for (size_t size = 0; size < 200; ++size) {
+            for (const auto& run :
+                 { std::string(size, ' '), std::string(size, '7'),
+                   std::string(size, 'q'), random_text(gen, size) }) {
+                const auto text = run + "\x01" + run;
+                scanner::use_kernel(scan_kernel::scalar);
+                const auto ws = scanner::whitespace_run(text);
+                const auto id = scanner::identifier_run(text);
+                const auto dg = scanner::digit_run(text);
+                const auto nl = scanner::count_newlines(text);
+                std::vector<size_t> st;
+                scanner::structural(text, st);
+                scanner::use_kernel(kernel);
+                EXPECT_EQ(scanner::whitespace_run(text), ws);
+                EXPECT_EQ(scanner::identifier_run(text), id);
+                EXPECT_EQ(scanner::digit_run(text), dg);
+                EXPECT_EQ(scanner::count_newlines(text), nl);
+                std::vector<size_t> structural;
+                scanner::structural(text, structural);
+                EXPECT_EQ(structural, st);
+            }
+        }
+    }
+    EXPECT_TRUE(scanner::use_kernel(initial));
+}
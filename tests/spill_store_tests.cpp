@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "dump_helpers.hpp"
+#include "grouper.hpp"
+#include "interner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+TEST(SpillStoreTest, InflateRebuildsTheTree) {
+    reader r { "test_data/test12.qc" };
+    grouper g { r, 128 };
+    const auto root = g.parse();
+    placeholder_node origin;
+    origin.limit = 128;
+    origin.src = &r;
+    const auto copy = flat_tree { *root }.inflate(origin);
+    std::ostringstream expected;
+    std::ostringstream actual;
+    root->dump(expected, r.lines(), "", true, false);
+    copy->dump(actual, r.lines(), "", true, false);
+    EXPECT_EQ(actual.str(), expected.str());
+    EXPECT_EQ(dumped(*copy, r.lines(), true), dumped(*root, r.lines(), true));
+    EXPECT_EQ(copy->full_size, root->full_size);
+    EXPECT_EQ(copy->fixed_bytes, root->fixed_bytes);
+}
+
+TEST(SpillStoreTest, ReloadsExpandedSubtrees) {
+    std::string expected;
+    {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, 128 };
+        expected = dumped(*g.parse(), r.lines(), true);
+    }
+    reader r { "test_data/test12.qc" };
+    spill_store spill;
+    grouper g { r, 128, nullptr, &spill };
+    const auto root = g.parse();
+    EXPECT_EQ(dumped(*root, r.lines(), true), expected);
+    const size_t spilled = spill.size();
+    EXPECT_GT(spilled, 0u);
+    EXPECT_GT(spill.bytes(), 0u);
+    EXPECT_EQ(spill.reloads(), 0u);
+    EXPECT_EQ(dumped(*root, r.lines(), true), expected);
+    EXPECT_EQ(spill.size(), spilled);
+    EXPECT_EQ(spill.reloads(), spilled);
+}
+
+/// Byte counters of the subtree of @p root, in pre-order.
+static std::vector<size_t> byte_counters(const ast_node& root) {
+    std::vector<size_t> counters;
+    std::vector<const ast_node*> pending { &root };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        counters.push_back(node->fixed_bytes);
+        counters.push_back(node->full_bytes);
+        std::vector<const ast_node*> children;
+        for_each_child(*node, [&children](const ast_node& child) {
+            children.push_back(&child);
+        });
+        pending.insert(pending.end(), children.rbegin(), children.rend());
+    }
+    return counters;
+}
+
+TEST(SpillStoreTest, ReloadKeepsByteCounters) {
+    reader r { "test_data/test12.qc" };
+    spill_store spill;
+    grouper g { r, 64, nullptr, &spill };
+    const auto root = g.parse();
+    std::vector<const placeholder_node*> placeholders;
+    std::vector<const ast_node*> pending { root.get() };
+    while (!pending.empty()) {
+        const ast_node* node = pending.back();
+        pending.pop_back();
+        if (isa<placeholder_node>(node)) {
+            placeholders.push_back(static_cast<const placeholder_node*>(node));
+        }
+        for_each_child(*node, [&pending](const ast_node& child) {
+            pending.push_back(&child);
+        });
+    }
+    ASSERT_FALSE(placeholders.empty());
+    for (const auto* ph : placeholders) {
+        const auto parsed = ph->expand();
+        const size_t reloads = spill.reloads();
+        const auto reloaded = ph->expand();
+        EXPECT_EQ(spill.reloads(), reloads + 1);
+        EXPECT_EQ(byte_counters(*reloaded), byte_counters(*parsed));
+        EXPECT_EQ(flat_tree { *reloaded }.size(), flat_tree { *parsed }.size());
+    }
+}
+
+TEST(SpillStoreTest, WorksWithCacheAndBudget) {
+    reader r { "test_data/test12.qc" };
+    subtree_cache cache { 8192 };
+    spill_store spill;
+    grouper g { r, memory_budget { 32768 }, &cache, &spill };
+    const auto root = g.parse();
+    const std::string first = dumped(*root, r.lines(), true);
+    EXPECT_EQ(dumped(*root, r.lines(), true), first);
+    EXPECT_EQ(dumped(*root, r.lines(), true), first);
+    EXPECT_GT(spill.size(), 0u);
+    EXPECT_LE(cache.bytes(), cache.budget());
+}
+
+TEST(SpillStoreTest, NestedPlaceholdersAtOneOffset) {
+    // see SubtreeCacheTest.NestedPlaceholdersAtOneOffset
+    const std::string source = "f() {\n  g(a, b, c, d);\n  h(a, b);\n}\n";
+    std::string expected;
+    {
+        std::string text = source;
+        reader r { text };
+        grouper g { r, 6 };
+        expected = dumped(*g.parse(), r.lines(), true);
+    }
+    std::string text = source;
+    reader r { text };
+    spill_store spill;
+    grouper g { r, 6, nullptr, &spill };
+    const auto root = g.parse();
+    EXPECT_EQ(dumped(*root, r.lines(), true), expected);
+    EXPECT_EQ(dumped(*root, r.lines(), true), expected);
+    EXPECT_EQ(spill.size(), 2u);
+}
+
+TEST(SpillStoreTest, MissingEntry) {
+    spill_store spill;
+    interner symbols;
+    EXPECT_FALSE(spill.load(subtree_key { 42 }, symbols).has_value());
+    EXPECT_EQ(spill.size(), 0u);
+}
@@ -0,0 +1,144 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 Yaroslav Riabtsev <yaroslav.riabtsev@rwth-aachen.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "grouper.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+static ast_root make_subtree() {
+    std::string source = "a;";
+    reader r { source };
+    grouper g { r };
+    return g.parse();
+}
+
+/// Key of a body region starting at @p offset.
+static subtree_key at(const std::streamoff offset) {
+    return { offset, offset + 10, group_kind::body, 64, 0 };
+}
+
+TEST(SubtreeCacheTest, EvictsLeastRecentlyUsed) {
+    subtree_cache cache { 300 };
+    cache.insert(at(1), make_subtree(), 100);
+    cache.insert(at(2), make_subtree(), 100);
+    cache.insert(at(3), make_subtree(), 100);
+    EXPECT_NE(cache.find(at(1)), nullptr);
+    cache.insert(at(4), make_subtree(), 100);
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(cache.bytes(), 300u);
+    EXPECT_EQ(cache.find(at(2)), nullptr);
+    EXPECT_NE(cache.find(at(1)), nullptr);
+    EXPECT_NE(cache.find(at(3)), nullptr);
+    EXPECT_NE(cache.find(at(4)), nullptr);
+    EXPECT_EQ(cache.hits(), 4u);
+    EXPECT_EQ(cache.misses(), 1u);
+
+    cache.insert(at(5), make_subtree(), 301);
+    EXPECT_EQ(cache.find(at(5)), nullptr);
+    cache.insert(at(1), make_subtree(), 250);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.bytes(), 250u);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.bytes(), 0u);
+}
+
+TEST(SubtreeCacheTest, RepeatedFullDumpsHitTheCache) {
+    std::string expected;
+    {
+        reader r { "test_data/test12.qc" };
+        grouper g { r, 128 };
+        std::ostringstream os;
+        g.parse()->dump(os, r.lines(), "", true, true);
+        expected = os.str();
+    }
+    reader r { "test_data/test12.qc" };
+    subtree_cache cache { size_t { 1 } << 24 };
+    grouper g { r, 128, &cache };
+    const auto root = g.parse();
+    for (int pass = 0; pass < 3; ++pass) {
+        std::ostringstream os;
+        root->dump(os, r.lines(), "", true, true);
+        EXPECT_EQ(os.str(), expected);
+    }
+    EXPECT_GT(cache.misses(), 0u);
+    EXPECT_EQ(cache.hits(), 2 * cache.misses());
+    EXPECT_LE(cache.bytes(), cache.budget());
+}
+
+TEST(SubtreeCacheTest, TightBudgetStaysBounded) {
+    reader r { "test_data/test12.qc" };
+    subtree_cache cache { 4096 };
+    grouper g { r, 128, &cache };
+    const auto root = g.parse();
+    std::ostringstream first;
+    std::ostringstream second;
+    root->dump(first, r.lines(), "", true, true);
+    root->dump(second, r.lines(), "", true, true);
+    EXPECT_EQ(first.str(), second.str());
+    EXPECT_LE(cache.bytes(), 4096u);
+}
+
+TEST(SubtreeCacheTest, KeysTellRegionsAtOneOffsetApart) {
+    subtree_cache cache { 300 };
+    auto list = at(1);
+    list.kind = group_kind::list;
+    auto shorter = at(1);
+    shorter.end = 5;
+    cache.insert(at(1), make_subtree(), 100);
+    EXPECT_EQ(cache.find(list), nullptr);
+    EXPECT_EQ(cache.find(shorter), nullptr);
+    cache.insert(list, make_subtree(), 100);
+    EXPECT_NE(cache.find(at(1)), cache.find(list));
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST(SubtreeCacheTest, NestedPlaceholdersAtOneOffset) {
+    // the body and its first command, squeezed when the body is expanded,
+    // both start at "g"
+    const std::string source = "f() {\n  g(a, b, c, d);\n  h(a, b);\n}\n";
+    std::string expected;
+    {
+        std::string text = source;
+        reader r { text };
+        grouper g { r, 6 };
+        std::ostringstream os;
+        g.parse()->dump(os, r.lines(), "", true, true);
+        expected = os.str();
+    }
+    std::string text = source;
+    reader r { text };
+    subtree_cache cache { size_t { 1 } << 20 };
+    grouper g { r, 6, &cache };
+    const auto root = g.parse();
+    for (int pass = 0; pass < 2; ++pass) {
+        std::ostringstream os;
+        root->dump(os, r.lines(), "", true, true);
+        EXPECT_EQ(os.str(), expected);
+    }
+    EXPECT_EQ(cache.size(), 2u);
+}